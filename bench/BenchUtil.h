@@ -0,0 +1,46 @@
+#pragma once
+
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "../src/physics/PhysicsObject.h"
+#include "../src/Shape.h"
+
+using namespace std;
+
+// Helpers shared by the benches, each of which is its own program
+
+// Uniform in [low, high], from rand so a bench can seed it with srand
+inline float randomRange(float low, float high)
+{
+    return low + (high - low) * (rand() % 10001) / 10000.0f;
+}
+
+// Moves the contacts made since the last call out of World.contacts
+inline void takeContacts(vector<Collision> &contacts)
+{
+    contacts.clear();
+    for (int i = 0; i < World.contacts.size(); i++)
+    {
+        contacts.push_back(World.contacts.getRecord(i).collision);
+    }
+    World.contacts.clear();
+}
+
+// Loads resourceDir/models/name resized to [-1, 1], or nullptr if it can't be read
+inline shared_ptr<Shape> loadModel(const string &resourceDir, const string &name)
+{
+    auto shape = make_shared<Shape>();
+    shape->loadMesh(resourceDir + "/models/" + name);
+    if (shape->getNumFaces() == 0)
+    {
+        cerr << "could not load " << name << endl;
+        return nullptr;
+    }
+    shape->resize();
+    shape->measure();
+    return shape;
+}
@@ -0,0 +1,286 @@
+/*
+ * Measures sphere vs mesh contact generation throughput.
+ * Compares checkSphereMesh against the old version of the test, which made
+ * separate face, edge and vertex passes using the vector returning Shape
+ * accessors and deduplicated features by hashing their positions.
+ * The two deduplicate shared edges and vertices differently, so they can make
+ * a different number of contacts, but at every position they must agree on
+ * the deepest one: its penetration and its normal.
+ *
+ * usage: ContactBench [resource dir] [model]
+ */
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <unordered_set>
+
+#include "../src/physics/PhysicsObject.h"
+#include "../src/physics/ColliderSphere.h"
+#include "../src/physics/ColliderMesh.h"
+#include "BenchUtil.h"
+
+#include <glm/gtx/hash.hpp>
+
+using namespace std;
+using namespace glm;
+
+struct Edge
+{
+    vec3 v0, v1;
+
+    Edge(vec3 v0, vec3 v1) : v0(v0), v1(v1)
+    {
+    }
+
+    bool operator==(const Edge &e) const
+    {
+        return (v0 == e.v0 && v1 == e.v1) ||
+            (v0 == e.v1 && v1 == e.v0);
+    }
+};
+
+class EdgeHash
+{
+public:
+    size_t operator()(const Edge &e) const
+    {
+        return hash<vec3>()(e.v0) ^ hash<vec3>()(e.v1);
+    }
+};
+
+// three pass checkSphereMesh using the allocating getFace/getEdge accessors
+void checkSphereMeshThreePass(PhysicsObject *sphere, ColliderSphere *sphereCol, PhysicsObject *mesh, ColliderMesh *meshCol)
+{
+    if (distance2(sphere->getCenterPos(), mesh->getCenterPos()) <= pow(sphere->getRadius() + mesh->getRadius(), 2))
+    {
+        mat4 M = translate(mat4(1.f), mesh->position) * mat4_cast(mesh->orientation) * scale(mat4(1.f), mesh->scale);
+        Shape *shape = meshCol->mesh.get();
+
+        vec3 localCenter = (inverse(mesh->orientation) * (sphere->position - mesh->position)) / mesh->scale;
+        vec3 localExtent = sphere->getRadius() / abs(mesh->scale);
+        vector<int> faces;
+        shape->bvh.query(localCenter - localExtent, localCenter + localExtent, faces);
+        if (faces.empty())
+        {
+            return;
+        }
+
+        vector<unsigned int> edges;
+        vector<unsigned int> verts;
+        for (int face : faces)
+        {
+            for (int j = 0; j < 3; j++)
+            {
+                edges.push_back(shape->faceEdges[face * 3 + j]);
+                verts.push_back(shape->getFaceIndex(face, j));
+            }
+        }
+        sort(edges.begin(), edges.end());
+        edges.erase(unique(edges.begin(), edges.end()), edges.end());
+        sort(verts.begin(), verts.end());
+        verts.erase(unique(verts.begin(), verts.end()), verts.end());
+
+        unordered_set<Edge, EdgeHash> edgeSet;
+        unordered_set<vec3> vertSet;
+        for (int i : faces)
+        {
+            vector<vec3> v = shape->getFace(i, M);
+            vec3 dir = -normalize(cross(v[1] - v[0], v[2] - v[0]));
+            vec2 bary;
+            float d;
+            if (intersectRayTriangle(sphere->position, dir, v[0], v[1], v[2], bary, d) && d > 0 && d < sphere->getRadius())
+            {
+                Collision collision;
+                collision.other = mesh;
+                collision.normal = dir;
+                collision.penetration = sphere->getRadius() - d;
+                collision.geom = FACE;
+                collision.v[0] = v[0];
+                collision.v[1] = v[1];
+                collision.v[2] = v[2];
+                collision.pos = sphere->position + collision.normal * d;
+                World.contacts.add(sphere->getBody(), collision);
+                edgeSet.insert(Edge(v[0], v[1]));
+                edgeSet.insert(Edge(v[1], v[2]));
+                edgeSet.insert(Edge(v[2], v[0]));
+            }
+        }
+        for (unsigned int i : edges)
+        {
+            vector<vec3> v = shape->getEdge(i, M);
+            if (edgeSet.find(Edge(v[0], v[1])) != edgeSet.end())
+            {
+                continue;
+            }
+            vec3 closestPoint = v[0] + proj(sphere->position - v[0], normalize(v[1] - v[0]));
+            float d = distance(sphere->position, closestPoint);
+            if (d < sphere->getRadius() &&
+                dot(v[1] - v[0], closestPoint - v[0]) > 0 && dot(v[0] - v[1], closestPoint - v[1]) > 0)
+            {
+                Collision collision;
+                collision.other = mesh;
+                collision.normal = normalize(closestPoint - sphere->position);
+                collision.penetration = sphere->getRadius() - d;
+                collision.geom = EDGE;
+                collision.pos = closestPoint;
+                World.contacts.add(sphere->getBody(), collision);
+                vertSet.insert(v[0]);
+                vertSet.insert(v[1]);
+            }
+        }
+        for (unsigned int i : verts)
+        {
+            vec3 v = shape->getVertex(i, M);
+            if (vertSet.find(v) != vertSet.end())
+            {
+                continue;
+            }
+            float d = distance(sphere->position, v);
+            if (d < sphere->getRadius())
+            {
+                Collision collision;
+                collision.other = mesh;
+                collision.normal = normalize(v - sphere->position);
+                collision.penetration = sphere->getRadius() - d;
+                collision.geom = VERT;
+                collision.pos = v;
+                World.contacts.add(sphere->getBody(), collision);
+            }
+        }
+    }
+}
+
+static int getDeepest(const vector<Collision> &contacts)
+{
+    int deepest = 0;
+    for (int i = 1; i < (int)contacts.size(); i++)
+    {
+        if (contacts[i].penetration > contacts[deepest].penetration)
+        {
+            deepest = i;
+        }
+    }
+    return deepest;
+}
+
+// The deepest contacts have the same penetration, and b's deepest normal is
+// the normal of one of a's contacts that deep. Two features can be equally
+// deep, so a's deepest may be the other one.
+static bool sameDeepest(const vector<Collision> &a, const vector<Collision> &b)
+{
+    if (a.empty() || b.empty())
+    {
+        return a.empty() == b.empty();
+    }
+    const Collision &deepest = b[getDeepest(b)];
+    if (fabs(a[getDeepest(a)].penetration - deepest.penetration) > 1e-4f)
+    {
+        return false;
+    }
+    for (const Collision &c : a)
+    {
+        if (fabs(c.penetration - deepest.penetration) <= 1e-4f && dot(c.normal, deepest.normal) > 0.999f)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+typedef void (*SphereMeshTest)(PhysicsObject *, ColliderSphere *, PhysicsObject *, ColliderMesh *);
+
+// Runs the test for every sphere position and returns the number of contacts made
+long run(SphereMeshTest test, const vector<vec3> &positions, int rounds, PhysicsObject *sphere, ColliderSphere *sphereCol,
+    PhysicsObject *mesh, ColliderMesh *meshCol, double &seconds)
+{
+    long contacts = 0;
+    auto start = chrono::high_resolution_clock::now();
+    for (int r = 0; r < rounds; r++)
+    {
+        for (const vec3 &p : positions)
+        {
+            sphere->position = p;
+            test(sphere, sphereCol, mesh, meshCol);
+            contacts += World.contacts.size();
+            World.contacts.clear();
+        }
+    }
+    seconds = chrono::duration<double>(chrono::high_resolution_clock::now() - start).count();
+    return contacts;
+}
+
+int main(int argc, char *argv[])
+{
+    string resourceDir = argc >= 2 ? argv[1] : "../resources";
+    string model = argc >= 3 ? argv[2] : "bunny.obj";
+
+    auto shape = make_shared<Shape>();
+    shape->loadMesh(resourceDir + "/models/" + model);
+    if (shape->getNumFaces() == 0)
+    {
+        cerr << "could not load " << model << endl;
+        return 1;
+    }
+    shape->resize();
+    shape->measure();
+
+    auto meshCol = make_shared<ColliderMesh>(shape);
+    auto mesh = make_shared<PhysicsObject>(vec3(0), quat(1, 0, 0, 0), vec3(4), shape, meshCol);
+    auto sphereCol = make_shared<ColliderSphere>(0.25f);
+    auto sphere = make_shared<PhysicsObject>(vec3(0), nullptr, sphereCol);
+
+    // spheres resting against the surface, found by pushing them in from outside
+    srand(572);
+    vector<vec3> positions;
+    while (positions.size() < 2000)
+    {
+        vec3 dir = normalize(vec3(rand() % 2001 - 1000, rand() % 2001 - 1000, rand() % 2001 - 1000) + 0.001f);
+        for (float t = 6.0f; t > 0; t -= 0.02f)
+        {
+            sphere->position = dir * t;
+            checkSphereMesh(sphere.get(), sphereCol.get(), mesh.get(), meshCol.get());
+            bool touching = World.contacts.size() > 0;
+            World.contacts.clear();
+            if (touching)
+            {
+                positions.push_back(sphere->position);
+                break;
+            }
+        }
+    }
+
+    int mismatches = 0;
+    vector<Collision> oldMade, newMade;
+    for (const vec3 &p : positions)
+    {
+        sphere->position = p;
+        checkSphereMeshThreePass(sphere.get(), sphereCol.get(), mesh.get(), meshCol.get());
+        takeContacts(oldMade);
+        checkSphereMesh(sphere.get(), sphereCol.get(), mesh.get(), meshCol.get());
+        takeContacts(newMade);
+        if (!sameDeepest(oldMade, newMade))
+        {
+            mismatches++;
+        }
+    }
+
+    int rounds = 20;
+    double oldTime, newTime;
+    long oldContacts = run(checkSphereMeshThreePass, positions, rounds, sphere.get(), sphereCol.get(), mesh.get(), meshCol.get(), oldTime);
+    long newContacts = run(checkSphereMesh, positions, rounds, sphere.get(), sphereCol.get(), mesh.get(), meshCol.get(), newTime);
+
+    long calls = (long)positions.size() * rounds;
+    printf("%s: %d faces, %ld sphere-mesh tests\n", model.c_str(), shape->getNumFaces(), calls);
+    printf("  three pass:     %8.1f ns/test %12.0f contacts/s (%ld contacts)\n",
+        oldTime * 1e9 / calls, oldContacts / oldTime, oldContacts);
+    printf("  checkSphereMesh:%8.1f ns/test %12.0f contacts/s (%ld contacts)\n",
+        newTime * 1e9 / calls, newContacts / newTime, newContacts);
+    if (mismatches > 0)
+    {
+        printf("  deepest contact differs at %d of %zu positions!\n", mismatches, positions.size());
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,224 @@
+/*
+ * Measures the edge filter PhysicsObject::update runs over a body's contacts.
+ * Compares filterEdgeContacts against the old version, which tested every face
+ * contact against every edge and vertex contact and erased the dropped ones one
+ * at a time. Both have to keep exactly the same contacts, or the bench exits
+ * with 1.
+ *
+ * The contact sets are what a big body resting on a finely tessellated floor
+ * mesh and leaning on a wall sees: face, edge and vertex contacts from the
+ * floor, and a few from the wall. On the bumpy floor every face has its own
+ * normal.
+ *
+ * usage: ContactFilterBench
+ */
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <unordered_set>
+
+#include "../src/physics/PhysicsObject.h"
+#include "../src/physics/ColliderSphere.h"
+#include "BenchUtil.h"
+
+using namespace std;
+using namespace glm;
+
+// the filter as it was, over a vector of contacts
+static void filterPairwise(vector<Collision> &contacts)
+{
+    vector<Collision *> faceCollisions;
+    vector<Collision *> notFaceCollisions;
+    for (int i = 0; i < (int)contacts.size(); i++)
+    {
+        switch (contacts[i].geom)
+        {
+            case FACE:
+                faceCollisions.push_back(&contacts[i]);
+                break;
+            case EDGE:
+            case VERT:
+                notFaceCollisions.push_back(&contacts[i]);
+                break;
+            default:
+                break;
+        }
+    }
+    unordered_set<Collision *> collisionsToRemove;
+    for (int i = 0; i < (int)faceCollisions.size(); i++)
+    {
+        for (int j = 0; j < (int)notFaceCollisions.size(); j++)
+        {
+            if (faceCollisions[i]->other != notFaceCollisions[j]->other)
+            {
+                float d = 0;
+                intersectRayPlane(notFaceCollisions[j]->pos, -faceCollisions[i]->normal,
+                    faceCollisions[i]->v[0], faceCollisions[i]->normal, d);
+                if (d < 0.1)
+                {
+                    collisionsToRemove.insert(notFaceCollisions[j]);
+                }
+            }
+        }
+    }
+    for (int i = (int)contacts.size() - 1; i >= 0 && !collisionsToRemove.empty(); i--)
+    {
+        if (collisionsToRemove.find(&contacts[i]) != collisionsToRemove.end())
+        {
+            collisionsToRemove.erase(&contacts[i]);
+            contacts.erase(contacts.begin() + i);
+        }
+    }
+}
+
+static float floorHeight(float x, float z, float bump)
+{
+    return bump * sin(x * 7.0f) * cos(z * 5.0f);
+}
+
+// n floor faces with n edges and vertices between them, and n / 8 wall contacts
+static vector<Collision> makeContacts(int n, float bump, PhysicsObject *floor, PhysicsObject *wall)
+{
+    vector<Collision> contacts;
+    for (int i = 0; i < n; i++)
+    {
+        float x = randomRange(-1, 1);
+        float z = randomRange(-1, 1);
+        float h = 0.05f;
+        vec3 v0(x, floorHeight(x, z, bump), z);
+        vec3 v1(x, floorHeight(x, z + h, bump), z + h);
+        vec3 v2(x + h, floorHeight(x + h, z, bump), z);
+
+        Collision face;
+        face.other = floor;
+        face.normal = -normalize(cross(v1 - v0, v2 - v0));
+        face.penetration = 0.01f;
+        face.geom = FACE;
+        face.v[0] = v0;
+        face.v[1] = v1;
+        face.v[2] = v2;
+        face.pos = v0;
+        contacts.push_back(face);
+
+        Collision edge;
+        edge.other = floor;
+        edge.normal = face.normal;
+        edge.penetration = 0.01f;
+        edge.geom = i % 2 == 0 ? EDGE : VERT;
+        edge.pos = (v0 + v1) / 2.0f;
+        contacts.push_back(edge);
+    }
+    for (int i = 0; i < n / 8 + 1; i++)
+    {
+        // the wall's edges are under the floor, just above it, or well above it
+        float y = randomRange(-0.2f, 0.6f);
+        float z = randomRange(-1, 1);
+        Collision wallContact;
+        wallContact.other = wall;
+        wallContact.normal = vec3(1, 0, 0);
+        wallContact.penetration = 0.01f;
+        wallContact.geom = i % 4 == 0 ? FACE : EDGE;
+        wallContact.v[0] = vec3(1, 0, 0);
+        wallContact.v[1] = vec3(1, 1, 0);
+        wallContact.v[2] = vec3(1, 0, 1);
+        wallContact.pos = vec3(1, floorHeight(1, z, bump) + y, z);
+        contacts.push_back(wallContact);
+    }
+
+    // the tests don't report contacts in any particular order
+    for (int i = (int)contacts.size() - 1; i > 0; i--)
+    {
+        swap(contacts[i], contacts[rand() % (i + 1)]);
+    }
+    return contacts;
+}
+
+static bool sameContacts(const vector<Collision> &a, const Collision *b, int count)
+{
+    if ((int)a.size() != count)
+    {
+        return false;
+    }
+    for (int i = 0; i < count; i++)
+    {
+        if (a[i].other != b[i].other || a[i].geom != b[i].geom || a[i].pos != b[i].pos || a[i].normal != b[i].normal)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+int main(int argc, char *argv[])
+{
+    auto floor = make_shared<PhysicsObject>(vec3(0), nullptr, make_shared<ColliderSphere>(1.0f));
+    auto wall = make_shared<PhysicsObject>(vec3(0), nullptr, make_shared<ColliderSphere>(1.0f));
+
+    srand(572);
+    const char *floorNames[] = {"flat", "bumpy"};
+    float bumps[] = {0.0f, 0.02f};
+    int sizes[] = {8, 32, 128, 512};
+    vector<Collision> oldContacts;
+    vector<Collision> newContacts;
+    bool ok = true;
+    for (int b = 0; b < 2; b++)
+    {
+        printf("%s floor:\n", floorNames[b]);
+        for (int n : sizes)
+        {
+            vector<vector<Collision>> sets;
+            for (int i = 0; i < 64; i++)
+            {
+                sets.push_back(makeContacts(n, bumps[b], floor.get(), wall.get()));
+            }
+            int rounds = max(1, 4096 / n);
+
+            long oldKept = 0;
+            auto start = chrono::high_resolution_clock::now();
+            for (int r = 0; r < rounds; r++)
+            {
+                for (const vector<Collision> &set : sets)
+                {
+                    oldContacts = set;
+                    filterPairwise(oldContacts);
+                    oldKept += oldContacts.size();
+                }
+            }
+            double oldTime = chrono::duration<double>(chrono::high_resolution_clock::now() - start).count();
+
+            long newKept = 0;
+            start = chrono::high_resolution_clock::now();
+            for (int r = 0; r < rounds; r++)
+            {
+                for (const vector<Collision> &set : sets)
+                {
+                    newContacts = set;
+                    newKept += filterEdgeContacts(newContacts.data(), (int)newContacts.size());
+                }
+            }
+            double newTime = chrono::duration<double>(chrono::high_resolution_clock::now() - start).count();
+
+            int mismatches = 0;
+            for (const vector<Collision> &set : sets)
+            {
+                oldContacts = set;
+                filterPairwise(oldContacts);
+                newContacts = set;
+                int kept = filterEdgeContacts(newContacts.data(), (int)newContacts.size());
+                if (!sameContacts(oldContacts, newContacts.data(), kept))
+                {
+                    mismatches++;
+                }
+            }
+            ok = ok && mismatches == 0;
+
+            long calls = (long)sets.size() * rounds;
+            printf("  %4zu contacts: pairwise %10.0f ns  filterEdgeContacts %8.0f ns  (%.1fx, kept %ld / %ld, %d mismatches)\n",
+                sets[0].size(), oldTime * 1e9 / calls, newTime * 1e9 / calls, oldTime / newTime,
+                newKept / calls, oldKept / calls, mismatches);
+        }
+    }
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,382 @@
+/*
+ * Checks and measures the GJK/EPA tests behind ColliderConvex.
+ * Spheres against a hull are compared with checkSphereMesh on the same convex
+ * mesh, which finds the nearest feature by looking at every triangle near the
+ * sphere. Boxes and hulls against hulls are compared with a brute force
+ * separating axis test over every face normal and every pair of edges, which
+ * gives the shortest way out exactly.
+ *
+ * A contact matches when its depth is the overlap along its normal, and that is
+ * no more than the shortest way out, give or take the 5% each of the two face
+ * normals tried is preferred by. The shapes are placed at random overlapping
+ * each other by up to 0.2. Exits with 1 if any contact doesn't match.
+ *
+ * usage: ConvexBench [resource dir]
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+
+#include "../src/physics/PhysicsObject.h"
+#include "../src/physics/ColliderSphere.h"
+#include "../src/physics/ColliderBox.h"
+#include "../src/physics/ColliderMesh.h"
+#include "../src/physics/ColliderConvex.h"
+#include "BenchUtil.h"
+
+#define GLM_ENABLE_EXPERIMENTAL
+#include <glm/gtx/quaternion.hpp>
+
+using namespace std;
+using namespace glm;
+
+// A convex shape in world space, with every direction the brute force test has
+// to try
+struct Polytope
+{
+    vector<vec3> points;
+    vector<vec3> normals;
+    vector<vec3> edges;
+
+    float support(const vec3 &dir) const
+    {
+        float best = -INFINITY;
+        for (const vec3 &p : points)
+        {
+            best = std::max(best, dot(p, dir));
+        }
+        return best;
+    }
+};
+
+static vec3 toWorld(PhysicsObject *obj, const vec3 &p)
+{
+    return obj->position + obj->orientation * (obj->scale * p);
+}
+
+static Polytope getPolytope(PhysicsObject *obj, ColliderConvex *col)
+{
+    Polytope poly;
+    const vector<vec3> &vertices = col->hull.getVertices();
+    const vector<unsigned int> &faces = col->hull.getFaces();
+    for (const vec3 &v : vertices)
+    {
+        poly.points.push_back(toWorld(obj, v));
+    }
+    for (size_t i = 0; i < faces.size(); i += 3)
+    {
+        vec3 v[3] = {poly.points[faces[i]], poly.points[faces[i + 1]], poly.points[faces[i + 2]]};
+        poly.normals.push_back(normalize(cross(v[1] - v[0], v[2] - v[0])));
+        // each edge is shared by two faces, going the other way in the second
+        for (int j = 0; j < 3; j++)
+        {
+            if (faces[i + j] < faces[i + (j + 1) % 3])
+            {
+                poly.edges.push_back(v[(j + 1) % 3] - v[j]);
+            }
+        }
+    }
+    return poly;
+}
+
+static Polytope getPolytope(PhysicsObject *obj, ColliderBox *col)
+{
+    Polytope poly;
+    vec3 h = col->halfSize;
+    for (int i = 0; i < 8; i++)
+    {
+        poly.points.push_back(toWorld(obj, vec3(i & 1 ? h.x : -h.x, i & 2 ? h.y : -h.y, i & 4 ? h.z : -h.z)));
+    }
+    for (int axis = 0; axis < 3; axis++)
+    {
+        vec3 dir(0);
+        dir[axis] = 1;
+        poly.normals.push_back(obj->orientation * dir);
+        poly.edges.push_back(obj->orientation * dir);
+    }
+    return poly;
+}
+
+static Polytope getPolytope(PhysicsObject *obj)
+{
+    Collider *col = obj->getCollider();
+    return col->type == COLLIDER_BOX ? getPolytope(obj, (ColliderBox *)col) : getPolytope(obj, (ColliderConvex *)col);
+}
+
+static float getOverlap(const Polytope &a, const Polytope &b, const vec3 &dir)
+{
+    return a.support(dir) + b.support(-dir);
+}
+
+// The shortest way out, negative if the shapes don't touch
+static float separatingAxisDepth(const Polytope &a, const Polytope &b)
+{
+    float depth = INFINITY;
+    for (const Polytope *p : {&a, &b})
+    {
+        for (const vec3 &n : p->normals)
+        {
+            depth = std::min(depth, std::min(getOverlap(a, b, n), getOverlap(a, b, -n)));
+        }
+    }
+    for (const vec3 &ea : a.edges)
+    {
+        for (const vec3 &eb : b.edges)
+        {
+            vec3 n = cross(ea, eb);
+            if (length2(n) > 1e-8f * length2(ea) * length2(eb))
+            {
+                n = normalize(n);
+                depth = std::min(depth, std::min(getOverlap(a, b, n), getOverlap(a, b, -n)));
+            }
+        }
+    }
+    return depth;
+}
+
+static quat randomOrientation()
+{
+    vec3 axis = normalize(vec3(rand() % 2001 - 1000, rand() % 2001 - 1000, rand() % 2001 - 1000) + 0.001f);
+    return angleAxis(rand() % 6284 / 1000.0f, axis);
+}
+
+// The deepest contact the test gave a, false if there isn't one
+static bool getDeepest(PhysicsObject *a, Collision &deepest)
+{
+    bool found = false;
+    for (int i = 0; i < World.contacts.size(); i++)
+    {
+        const ContactRecord &record = World.contacts.getRecord(i);
+        if (record.body == a->getBody() && (!found || record.collision.penetration > deepest.penetration))
+        {
+            deepest = record.collision;
+            found = true;
+        }
+    }
+    return found;
+}
+
+struct Placement
+{
+    vec3 position;
+    quat orientationA;
+    quat orientationB;
+};
+
+static void place(PhysicsObject *a, PhysicsObject *b, const Placement &placement)
+{
+    a->orientation = placement.orientationA;
+    b->position = placement.position;
+    b->orientation = placement.orientationB;
+}
+
+static double runTest(PhysicsObject *a, PhysicsObject *b, const vector<Placement> &placements, int rounds)
+{
+    auto start = chrono::high_resolution_clock::now();
+    for (int r = 0; r < rounds; r++)
+    {
+        for (const Placement &placement : placements)
+        {
+            place(a, b, placement);
+            a->checkCollision(b);
+            World.contacts.clear();
+        }
+    }
+    double seconds = chrono::duration<double>(chrono::high_resolution_clock::now() - start).count();
+    return seconds * 1e9 / (rounds * placements.size());
+}
+
+// b pushed into a from random directions until they overlap by up to 0.2. The
+// depth is the smallest of the overlaps along each axis, which all change
+// linearly with b's position, so it only grows as b moves in towards a's center
+// and the distance can be found by bisection.
+static vector<Placement> findPlacements(PhysicsObject *a, PhysicsObject *b, int count)
+{
+    vector<Placement> placements;
+    while ((int)placements.size() < count)
+    {
+        Placement placement;
+        placement.orientationA = randomOrientation();
+        placement.orientationB = randomOrientation();
+        vec3 dir = normalize(vec3(rand() % 2001 - 1000, rand() % 2001 - 1000, rand() % 2001 - 1000) + 0.001f);
+        float target = randomRange(0.005f, 0.2f);
+        float inside = 0;
+        float outside = a->getRadius() + b->getRadius();
+        placement.position = vec3(0);
+        place(a, b, placement);
+        if (separatingAxisDepth(getPolytope(a), getPolytope(b)) < target)
+        {
+            continue;
+        }
+        for (int i = 0; i < 20; i++)
+        {
+            float t = (inside + outside) / 2;
+            placement.position = dir * t;
+            place(a, b, placement);
+            if (separatingAxisDepth(getPolytope(a), getPolytope(b)) >= target)
+            {
+                inside = t;
+            }
+            else
+            {
+                outside = t;
+            }
+        }
+        placement.position = dir * inside;
+        placements.push_back(placement);
+    }
+    return placements;
+}
+
+// Hulls and boxes against a hull, checked against the separating axis test.
+// Returns the number of bad contacts.
+static int benchPolytopes(const char *name, PhysicsObject *a, PhysicsObject *b, int count, int rounds)
+{
+    vector<Placement> placements = findPlacements(a, b, count);
+    int missed = 0;
+    int wrongDepth = 0;
+    int tooDeep = 0;
+    float worst = 0;
+    for (const Placement &placement : placements)
+    {
+        place(a, b, placement);
+        a->checkCollision(b);
+        Collision contact;
+        bool found = getDeepest(a, contact);
+        World.contacts.clear();
+        if (!found)
+        {
+            missed++;
+            continue;
+        }
+        Polytope pa = getPolytope(a);
+        Polytope pb = getPolytope(b);
+        float depth = separatingAxisDepth(pa, pb);
+        if (fabs(getOverlap(pa, pb, contact.normal) - contact.penetration) > 1e-3f)
+        {
+            wrongDepth++;
+        }
+        if (contact.penetration > depth / (0.95f * 0.95f) + 1e-3f)
+        {
+            tooDeep++;
+        }
+        worst = std::max(worst, contact.penetration / depth);
+    }
+    printf("%-12s %5d tests %8.1f ns/test  %d missed  %d not the overlap along the normal  %d too deep  (at most %.3fx the shortest way out)\n",
+        name, count, runTest(a, b, placements, rounds), missed, wrongDepth, tooDeep, worst);
+    return missed + wrongDepth + tooDeep;
+}
+
+// Spheres against a hull, checked against the same mesh as a ColliderMesh.
+// Returns the number of bad contacts.
+static int benchSpheres(PhysicsObject *sphere, PhysicsObject *convex, PhysicsObject *mesh, int count, int rounds)
+{
+    // spheres found by pushing them in from outside like ContactBench does, then
+    // a little further
+    vector<Placement> placements;
+    while ((int)placements.size() < count)
+    {
+        Placement placement;
+        placement.orientationA = quat(1, 0, 0, 0);
+        placement.orientationB = convex->orientation;
+        vec3 dir = normalize(vec3(rand() % 2001 - 1000, rand() % 2001 - 1000, rand() % 2001 - 1000) + 0.001f);
+        for (float t = sphere->getRadius() + convex->getRadius(); t > 0; t -= 0.002f)
+        {
+            sphere->position = dir * t;
+            checkSphereMesh(sphere, (ColliderSphere *)sphere->getCollider(), mesh, (ColliderMesh *)mesh->getCollider());
+            bool touching = World.contacts.size() > 0;
+            World.contacts.clear();
+            if (touching)
+            {
+                placement.position = dir * (t - randomRange(0, 0.2f));
+                placements.push_back(placement);
+                break;
+            }
+        }
+    }
+
+    int missed = 0;
+    int different = 0;
+    for (const Placement &placement : placements)
+    {
+        sphere->position = placement.position;
+        Collision contacts[2];
+        bool found[2];
+        checkSphereConvex(sphere, (ColliderSphere *)sphere->getCollider(), convex, (ColliderConvex *)convex->getCollider());
+        found[0] = getDeepest(sphere, contacts[0]);
+        World.contacts.clear();
+        checkSphereMesh(sphere, (ColliderSphere *)sphere->getCollider(), mesh, (ColliderMesh *)mesh->getCollider());
+        found[1] = getDeepest(sphere, contacts[1]);
+        World.contacts.clear();
+        if (!found[0] || !found[1])
+        {
+            missed += found[0] != found[1];
+            continue;
+        }
+        if (fabs(contacts[0].penetration - contacts[1].penetration) > 1e-3f || dot(contacts[0].normal, contacts[1].normal) < 0.999f)
+        {
+            different++;
+        }
+    }
+
+    // the sphere moves, so the timing loop keeps the hull and mesh still
+    double times[2];
+    PhysicsObject *others[2] = {convex, mesh};
+    for (int i = 0; i < 2; i++)
+    {
+        auto start = chrono::high_resolution_clock::now();
+        for (int r = 0; r < rounds; r++)
+        {
+            for (const Placement &placement : placements)
+            {
+                sphere->position = placement.position;
+                sphere->checkCollision(others[i]);
+                World.contacts.clear();
+            }
+        }
+        times[i] = chrono::duration<double>(chrono::high_resolution_clock::now() - start).count() * 1e9 / (rounds * count);
+    }
+    printf("%-12s %5d tests %8.1f ns/test  %d missed  %d different from the mesh (%.1f ns/test)\n",
+        "sphere-hull", count, times[0], missed, different, times[1]);
+    return missed + different;
+}
+
+int main(int argc, char *argv[])
+{
+    string resourceDir = argc >= 2 ? argv[1] : "../resources";
+    shared_ptr<Shape> cube = loadModel(resourceDir, "cube.obj");
+    shared_ptr<Shape> rockShape = loadModel(resourceDir, "sphere.obj");
+    if (cube == nullptr || rockShape == nullptr)
+    {
+        return 1;
+    }
+
+    // the rock is the convex sphere model, so its hull is the mesh itself
+    auto hullCol = make_shared<ColliderConvex>(cube);
+    auto rockCol = make_shared<ColliderConvex>(rockShape);
+    auto box = make_shared<PhysicsObject>(vec3(0), quat(1, 0, 0, 0), vec3(0.5f), nullptr, make_shared<ColliderBox>(vec3(1)));
+    auto hull = make_shared<PhysicsObject>(vec3(0), quat(1, 0, 0, 0), vec3(0.5f), nullptr, hullCol);
+    auto rock = make_shared<PhysicsObject>(vec3(0), quat(1, 0, 0, 0), vec3(0.6f), nullptr, rockCol);
+    auto rock2 = make_shared<PhysicsObject>(vec3(0), quat(1, 0, 0, 0), vec3(0.4f), nullptr, rockCol);
+    auto rockMesh = make_shared<PhysicsObject>(vec3(0), quat(1, 0, 0, 0), vec3(0.6f), nullptr, make_shared<ColliderMesh>(rockShape));
+    auto sphere = make_shared<PhysicsObject>(vec3(0), nullptr, make_shared<ColliderSphere>(0.3f));
+
+    srand(918);
+    int count = 2000;
+    int rounds = 20;
+    printf("hull: %d vertices, rock: %d vertices\n", hullCol->hull.getNumVertices(), rockCol->hull.getNumVertices());
+    int bad = benchSpheres(sphere.get(), rock.get(), rockMesh.get(), count, rounds);
+    bad += benchPolytopes("box-hull", box.get(), hull.get(), count, rounds);
+    bad += benchPolytopes("box-rock", box.get(), rock.get(), count, rounds);
+    bad += benchPolytopes("hull-rock", hull.get(), rock.get(), count, rounds);
+    bad += benchPolytopes("rock-rock", rock2.get(), rock.get(), count, rounds);
+    if (bad > 0)
+    {
+        printf("%d bad contacts!\n", bad);
+        return 1;
+    }
+    return 0;
+}
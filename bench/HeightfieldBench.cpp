@@ -0,0 +1,264 @@
+/*
+ * Checks and measures ColliderHeightfield against a ColliderMesh of the same
+ * sine terrain. The heightfield splits its cells the same way the mesh does,
+ * so both have to find the same contacts and sweep to the same point.
+ *
+ *     grid     the raw heights constructor, with the mesh built from the same
+ *              grid. Both are moved and turned.
+ *     sampled  the Shape sampling constructor over a mesh 60 x 40.5, which
+ *              takes 60 cells along x and 41 a little longer ones along z to
+ *              end on the mesh's edge. Its heights have to be the mesh's, and
+ *              spheres go right up to the edges.
+ *
+ * Exits with 1 if anything doesn't match.
+ *
+ * usage: HeightfieldBench
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+
+#include "../src/physics/PhysicsObject.h"
+#include "../src/physics/ColliderSphere.h"
+#include "../src/physics/ColliderMesh.h"
+#include "../src/physics/ColliderHeightfield.h"
+#include "BenchUtil.h"
+
+#define GLM_ENABLE_EXPERIMENTAL
+#include <glm/gtx/quaternion.hpp>
+
+using namespace std;
+using namespace glm;
+
+static float terrainHeight(float x, float z)
+{
+    return 1.5f * sin(x * 0.35f) * cos(z * 0.25f) + 0.5f * sin(z * 0.9f + x * 0.2f);
+}
+
+// The terrain over a grid of points, with each cell split along the same
+// diagonal as a heightfield's
+static shared_ptr<Shape> makeTerrainMesh(const vector<float> &xs, const vector<float> &zs)
+{
+    tinyobj::shape_t terrain;
+    int nx = (int)xs.size();
+    int nz = (int)zs.size();
+    for (int j = 0; j < nz; j++)
+    {
+        for (int i = 0; i < nx; i++)
+        {
+            terrain.mesh.positions.push_back(xs[i]);
+            terrain.mesh.positions.push_back(terrainHeight(xs[i], zs[j]));
+            terrain.mesh.positions.push_back(zs[j]);
+        }
+    }
+    for (int j = 0; j < nz - 1; j++)
+    {
+        for (int i = 0; i < nx - 1; i++)
+        {
+            unsigned int a = j * nx + i;
+            unsigned int b = a + 1;
+            unsigned int c = a + nx;
+            unsigned int d = a + nx + 1;
+            unsigned int faces[6] = {a, c, d, a, d, b};
+            terrain.mesh.indices.insert(terrain.mesh.indices.end(), faces, faces + 6);
+        }
+    }
+    auto shape = make_shared<Shape>();
+    shape->createShape(terrain);
+    shape->measure();
+    return shape;
+}
+
+static bool before(const Collision &a, const Collision &b)
+{
+    if (a.geom != b.geom) return a.geom < b.geom;
+    if (a.pos.x != b.pos.x) return a.pos.x < b.pos.x;
+    if (a.pos.y != b.pos.y) return a.pos.y < b.pos.y;
+    return a.pos.z < b.pos.z;
+}
+
+// The two tests number their triangles differently, so the contacts can come in
+// a different order
+static bool sameContacts(vector<Collision> &a, vector<Collision> &b)
+{
+    if (a.size() != b.size())
+    {
+        return false;
+    }
+    sort(a.begin(), a.end(), before);
+    sort(b.begin(), b.end(), before);
+    for (size_t i = 0; i < a.size(); i++)
+    {
+        if (a[i].geom != b[i].geom || distance(a[i].pos, b[i].pos) > 1e-4f ||
+            distance(a[i].normal, b[i].normal) > 1e-4f || fabs(a[i].penetration - b[i].penetration) > 1e-4f)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Spheres in the local box [min, max] of x and z, from a little below the
+// terrain to just touching it. Returns the number of mismatches.
+static int compare(const char *name, PhysicsObject *mesh, PhysicsObject *ground, vec2 min, vec2 max, float radius)
+{
+    auto sphereCol = make_shared<ColliderSphere>(radius);
+    auto sphere = make_shared<PhysicsObject>(vec3(0), nullptr, sphereCol);
+    ColliderMesh *meshCol = (ColliderMesh *)mesh->getCollider();
+    ColliderHeightfield *groundCol = (ColliderHeightfield *)ground->getCollider();
+
+    // sweeps come down from above the highest hill, from up to 2 to the side
+    vector<vec3> positions;
+    vector<vec3> starts;
+    for (int i = 0; i < 2000; i++)
+    {
+        float x = randomRange(min.x, max.x);
+        float z = randomRange(min.y, max.y);
+        vec3 local(x, terrainHeight(x, z) + randomRange(-0.3f, 1.0f) * radius, z);
+        vec3 above(x + randomRange(-2, 2), 2 + radius + 1, z + randomRange(-2, 2));
+        positions.push_back(ground->position + ground->orientation * local);
+        starts.push_back(ground->position + ground->orientation * above);
+    }
+
+    int contactMismatches = 0;
+    int sweepMismatches = 0;
+    long contacts = 0;
+    vector<Collision> meshContacts, groundContacts;
+    for (size_t i = 0; i < positions.size(); i++)
+    {
+        sphere->position = positions[i];
+        checkSphereMesh(sphere.get(), sphereCol.get(), mesh, meshCol);
+        takeContacts(meshContacts);
+        checkSphereHeightfield(sphere.get(), sphereCol.get(), ground, groundCol);
+        takeContacts(groundContacts);
+        contacts += groundContacts.size();
+        contactMismatches += !sameContacts(meshContacts, groundContacts);
+
+        float tMesh = sweepSphereMesh(sphere.get(), sphereCol.get(), starts[i], mesh, meshCol);
+        float tGround = sweepSphereHeightfield(sphere.get(), sphereCol.get(), starts[i], ground, groundCol);
+        sweepMismatches += fabs(tMesh - tGround) > 1e-4f;
+    }
+
+    int rounds = 10;
+    double times[4] = {0, 0, 0, 0};
+    for (int r = 0; r < rounds; r++)
+    {
+        for (int k = 0; k < 4; k++)
+        {
+            auto start = chrono::high_resolution_clock::now();
+            for (size_t i = 0; i < positions.size(); i++)
+            {
+                sphere->position = positions[i];
+                switch (k)
+                {
+                    case 0: checkSphereHeightfield(sphere.get(), sphereCol.get(), ground, groundCol); break;
+                    case 1: checkSphereMesh(sphere.get(), sphereCol.get(), mesh, meshCol); break;
+                    case 2: sweepSphereHeightfield(sphere.get(), sphereCol.get(), starts[i], ground, groundCol); break;
+                    case 3: sweepSphereMesh(sphere.get(), sphereCol.get(), starts[i], mesh, meshCol); break;
+                }
+                World.contacts.clear();
+            }
+            times[k] += chrono::duration<double>(chrono::high_resolution_clock::now() - start).count();
+        }
+    }
+    long calls = (long)positions.size() * rounds;
+    printf("  %-8s radius %.1f: contacts %7.1f ns, mesh %7.1f ns  sweeps %7.1f ns, mesh %7.1f ns  (%ld contacts, %d and %d mismatches)\n",
+        name, radius, times[0] * 1e9 / calls, times[1] * 1e9 / calls, times[2] * 1e9 / calls, times[3] * 1e9 / calls,
+        contacts, contactMismatches, sweepMismatches);
+    return contactMismatches + sweepMismatches;
+}
+
+int main(int argc, char *argv[])
+{
+    srand(572);
+    float radii[] = {0.1f, 0.5f};
+    int bad = 0;
+
+    // the raw heights constructor
+    {
+        int width = 201;
+        int depth = 161;
+        float cellSize = 0.25f;
+        vec2 origin = -vec2(width - 1, depth - 1) * cellSize / 2.0f;
+        vector<float> xs, zs, heights;
+        for (int x = 0; x < width; x++)
+        {
+            xs.push_back(origin.x + x * cellSize);
+        }
+        for (int z = 0; z < depth; z++)
+        {
+            zs.push_back(origin.y + z * cellSize);
+        }
+        for (int z = 0; z < depth; z++)
+        {
+            for (int x = 0; x < width; x++)
+            {
+                heights.push_back(terrainHeight(xs[x], zs[z]));
+            }
+        }
+
+        vec3 position(2, -1, 3);
+        quat orientation = angleAxis(0.4f, vec3(0, 1, 0));
+        auto mesh = make_shared<PhysicsObject>(position, orientation, nullptr, make_shared<ColliderMesh>(makeTerrainMesh(xs, zs)));
+        auto ground = make_shared<PhysicsObject>(position, orientation, nullptr,
+            make_shared<ColliderHeightfield>(heights, width, depth, cellSize));
+        printf("grid: %d x %d heights, %d faces\n", width, depth, (width - 1) * (depth - 1) * 2);
+        for (float radius : radii)
+        {
+            bad += compare("grid", mesh.get(), ground.get(), origin + 3.0f, -origin - 3.0f, radius);
+        }
+    }
+
+    // the Shape sampling constructor, over a mesh whose depth isn't a whole number of cells
+    {
+        vector<float> xs, zs;
+        for (int x = 0; x <= 60; x++)
+        {
+            xs.push_back((float)x);
+        }
+        // the rows the heightfield will sample, so the two have the same triangles
+        float depth = 40.5f;
+        for (int z = 0; z <= 41; z++)
+        {
+            zs.push_back(z * (depth / 41));
+        }
+        shared_ptr<Shape> shape = makeTerrainMesh(xs, zs);
+        auto groundCol = make_shared<ColliderHeightfield>(shape, 60);
+
+        // every grid point has the mesh's height
+        int wrongHeights = 0;
+        int numFaces = (groundCol->getWidth() - 1) * (groundCol->getDepth() - 1) * 2;
+        mat4 I(1.f);
+        for (int i = 0; i < numFaces; i++)
+        {
+            vec3 v[3];
+            groundCol->getFace(i, I, v);
+            for (int j = 0; j < 3; j++)
+            {
+                wrongHeights += fabs(v[j].y - terrainHeight(v[j].x, v[j].z)) > 1e-4f;
+            }
+        }
+        bad += wrongHeights;
+        printf("sampled: %d x %d heights from a %d face mesh, %d wrong heights\n",
+            groundCol->getWidth(), groundCol->getDepth(), shape->getNumFaces(), wrongHeights);
+
+        vec3 position(-30, 0, -20);
+        quat orientation(1, 0, 0, 0);
+        auto mesh = make_shared<PhysicsObject>(position, orientation, nullptr, make_shared<ColliderMesh>(shape));
+        auto ground = make_shared<PhysicsObject>(position, orientation, nullptr, groundCol);
+        for (float radius : radii)
+        {
+            bad += compare("sampled", mesh.get(), ground.get(), vec2(0, 0), vec2(60, depth), radius);
+        }
+    }
+
+    if (bad > 0)
+    {
+        printf("%d mismatches!\n", bad);
+        return 1;
+    }
+    return 0;
+}
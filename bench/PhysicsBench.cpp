@@ -0,0 +1,340 @@
+/*
+ * Runs whole physics steps on scenes built without a window, the same way
+ * updatePhysics in main.cpp does, and reports the time per step, the number of
+ * pairs and contacts and a checksum of the final state.
+ * Every run of a scene with the same settings should give the same checksum,
+ * whatever the number of threads.
+ *
+ * Scenes:
+ *     floors  spheres dropped over a row of cube meshes
+ *     stacks  columns of spheres resting on a floor
+ *     pile    spheres dropped into a box made of cube meshes
+ *     boxes   columns of boxes on a box floor, with capsules and fast spheres
+ *             dropped next to them
+ *     convex  columns of convex hull cubes topped with boxes on a cube mesh,
+ *             with round hulls and fast spheres dropped next to them
+ *
+ * Scenes with columns also report how many are still standing at the end.
+ * usage: PhysicsBench [resource dir] [scene|all] [steps] [threads] [sap|hash|tree] [solver iterations]
+ */
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+#include "../src/physics/PhysicsObject.h"
+#include "../src/physics/ColliderSphere.h"
+#include "../src/physics/ColliderMesh.h"
+#include "../src/physics/ColliderBox.h"
+#include "../src/physics/ColliderCapsule.h"
+#include "../src/physics/ColliderConvex.h"
+#include "../src/physics/SweepAndPrune.h"
+#include "../src/physics/SpatialHash.h"
+#include "../src/physics/AABBTree.h"
+#include "../src/physics/NarrowPhase.h"
+#include "../src/physics/IslandSolver.h"
+#include "BenchUtil.h"
+
+using namespace std;
+using namespace glm;
+
+static const char *sceneNames[] = {"floors", "stacks", "pile", "boxes", "convex"};
+
+// Both are resized to [-1, 1]
+struct Models
+{
+    shared_ptr<Shape> cube;
+    shared_ptr<Shape> sphere;
+};
+
+static shared_ptr<PhysicsObject> addMesh(vector<shared_ptr<PhysicsObject>> &objects, shared_ptr<Shape> cube, vec3 position, vec3 scale)
+{
+    auto mesh = make_shared<PhysicsObject>(position, quat(1, 0, 0, 0), scale, cube, make_shared<ColliderMesh>(cube));
+    mesh->setElasticity(0.5f);
+    mesh->setFriction(0.25f);
+    objects.push_back(mesh);
+    return mesh;
+}
+
+static shared_ptr<PhysicsObject> addSphere(vector<shared_ptr<PhysicsObject>> &objects, vec3 position, float radius)
+{
+    auto sphere = make_shared<PhysicsObject>(position, nullptr, make_shared<ColliderSphere>(radius));
+    sphere->setMass(1);
+    sphere->setElasticity(0.5f);
+    sphere->setFriction(0.25f);
+    objects.push_back(sphere);
+    return sphere;
+}
+
+static shared_ptr<PhysicsObject> addBody(vector<shared_ptr<PhysicsObject>> &objects, vec3 position, quat orientation, float scale, shared_ptr<Collider> collider)
+{
+    auto body = make_shared<PhysicsObject>(position, orientation, vec3(scale), nullptr, collider);
+    body->setMass(1);
+    body->setElasticity(0.5f);
+    body->setFriction(0.25f);
+    objects.push_back(body);
+    return body;
+}
+
+static quat randomOrientation()
+{
+    return angleAxis(randomRange(0, 6.28f), normalize(vec3(randomRange(-1, 1), randomRange(-1, 1), randomRange(-1, 1)) + 0.001f));
+}
+
+// Bodies stacked on top of each other, and where they started
+struct Column
+{
+    vector<shared_ptr<PhysicsObject>> bodies;
+    vector<vec3> start;
+
+    void add(shared_ptr<PhysicsObject> body)
+    {
+        bodies.push_back(body);
+        start.push_back(body->position);
+    }
+
+    // still where it was built, give or take what resting contacts sink in
+    bool standing() const
+    {
+        for (size_t i = 0; i < bodies.size(); i++)
+        {
+            if (distance(bodies[i]->position, start[i]) > 0.1f)
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+};
+
+// cube is resized to [-1, 1], so a floor at y = -1 with scale 1 in y has its top at 0
+static void buildScene(int scene, const Models &models, vector<shared_ptr<PhysicsObject>> &objects, vector<Column> &columns)
+{
+    shared_ptr<Shape> cube = models.cube;
+    srand(572);
+    if (scene == 0)
+    {
+        // 4 floors of 10 x 10, 600 spheres
+        for (int i = 0; i < 4; i++)
+        {
+            addMesh(objects, cube, vec3(i * 25 - 40, -1, 0), vec3(10, 1, 10));
+        }
+        for (int i = 0; i < 600; i++)
+        {
+            int floor = i % 4;
+            addSphere(objects, vec3(floor * 25 - 40 + randomRange(-9, 9), randomRange(1, 10), randomRange(-9, 9)), 0.5f);
+        }
+    }
+    else if (scene == 1)
+    {
+        // 20 x 20 columns of 4 spheres, just touching
+        addMesh(objects, cube, vec3(0, -1, 0), vec3(30, 1, 30));
+        for (int x = 0; x < 20; x++)
+        {
+            for (int z = 0; z < 20; z++)
+            {
+                for (int y = 0; y < 4; y++)
+                {
+                    addSphere(objects, vec3(x * 1.5f - 15, 0.5f + y * 0.99f, z * 1.5f - 15), 0.5f);
+                }
+            }
+        }
+    }
+    else if (scene == 2)
+    {
+        // 800 spheres poured into a 10 x 10 box
+        addMesh(objects, cube, vec3(0, -1, 0), vec3(6, 1, 6));
+        addMesh(objects, cube, vec3(-6, 5, 0), vec3(1, 5, 6));
+        addMesh(objects, cube, vec3(6, 5, 0), vec3(1, 5, 6));
+        addMesh(objects, cube, vec3(0, 5, -6), vec3(6, 5, 1));
+        addMesh(objects, cube, vec3(0, 5, 6), vec3(6, 5, 1));
+        for (int i = 0; i < 800; i++)
+        {
+            addSphere(objects, vec3(randomRange(-4.5f, 4.5f), randomRange(1, 30), randomRange(-4.5f, 4.5f)), 0.5f);
+        }
+    }
+    else if (scene == 3)
+    {
+        // 6 x 6 columns of 4 unit boxes, just touching, on the -x half of a 30 x 30
+        // box floor. 150 capsules and 100 spheres coming down fast on the +x half.
+        auto floor = make_shared<PhysicsObject>(vec3(0, -1, 0), quat(1, 0, 0, 0), vec3(15, 1, 15), nullptr, make_shared<ColliderBox>(vec3(1)));
+        floor->setElasticity(0.5f);
+        floor->setFriction(0.25f);
+        objects.push_back(floor);
+        auto box = make_shared<ColliderBox>(vec3(0.5f));
+        for (int x = 0; x < 6; x++)
+        {
+            for (int z = 0; z < 6; z++)
+            {
+                Column column;
+                for (int y = 0; y < 4; y++)
+                {
+                    column.add(addBody(objects, vec3(x * 2.2f - 13, 0.5f + y, z * 4.4f - 12), quat(1, 0, 0, 0), 1, box));
+                }
+                columns.push_back(column);
+            }
+        }
+        auto capsule = make_shared<ColliderCapsule>(0.3f, 0.5f);
+        for (int i = 0; i < 150; i++)
+        {
+            addBody(objects, vec3(randomRange(2, 13), randomRange(1, 15), randomRange(-13, 13)), randomOrientation(), 1, capsule);
+        }
+        for (int i = 0; i < 100; i++)
+        {
+            auto sphere = addSphere(objects, vec3(randomRange(2, 13), randomRange(15, 25), randomRange(-13, 13)), 0.25f);
+            sphere->setVelocity(vec3(0, -40, 0));
+        }
+    }
+    else
+    {
+        // 5 x 5 columns of 3 unit hull cubes with a box on top, just touching, on the
+        // -x half of a 30 x 30 cube mesh. 150 round hulls and 100 spheres coming down
+        // fast on the +x half.
+        addMesh(objects, cube, vec3(0, -1, 0), vec3(15, 1, 15));
+        auto hullCube = make_shared<ColliderConvex>(cube);
+        auto box = make_shared<ColliderBox>(vec3(0.5f));
+        for (int x = 0; x < 5; x++)
+        {
+            for (int z = 0; z < 5; z++)
+            {
+                Column column;
+                for (int y = 0; y < 3; y++)
+                {
+                    column.add(addBody(objects, vec3(x * 2.6f - 13, 0.5f + y, z * 5.2f - 12), quat(1, 0, 0, 0), 0.5f, hullCube));
+                }
+                column.add(addBody(objects, vec3(x * 2.6f - 13, 3.5f, z * 5.2f - 12), quat(1, 0, 0, 0), 1, box));
+                columns.push_back(column);
+            }
+        }
+        auto rock = make_shared<ColliderConvex>(models.sphere);
+        for (int i = 0; i < 150; i++)
+        {
+            addBody(objects, vec3(randomRange(2, 13), randomRange(1, 15), randomRange(-13, 13)), randomOrientation(), 0.4f, rock);
+        }
+        for (int i = 0; i < 100; i++)
+        {
+            auto sphere = addSphere(objects, vec3(randomRange(2, 13), randomRange(15, 25), randomRange(-13, 13)), 0.25f);
+            sphere->setVelocity(vec3(0, -40, 0));
+        }
+    }
+}
+
+static shared_ptr<Broadphase> makeBroadphase(const string &name)
+{
+    if (name == "sap")
+    {
+        return make_shared<SweepAndPrune>();
+    }
+    else if (name == "hash")
+    {
+        return make_shared<SpatialHash>();
+    }
+    return make_shared<AABBTree>();
+}
+
+// FNV-1a over the bits of every position and velocity
+static unsigned long long checksum(const vector<shared_ptr<PhysicsObject>> &objects)
+{
+    unsigned long long hash = 14695981039346656037ULL;
+    for (auto &obj : objects)
+    {
+        vec3 state[2] = {obj->position, obj->getVelocity()};
+        unsigned char bytes[sizeof(state)];
+        memcpy(bytes, state, sizeof(state));
+        for (unsigned char b : bytes)
+        {
+            hash = (hash ^ b) * 1099511628211ULL;
+        }
+    }
+    return hash;
+}
+
+static void runScene(int scene, const Models &models, int steps, shared_ptr<WorkerPool> pool, const string &broadphaseName)
+{
+    vector<shared_ptr<PhysicsObject>> objects;
+    vector<Column> columns;
+    buildScene(scene, models, objects, columns);
+
+    shared_ptr<Broadphase> broadphase = makeBroadphase(broadphaseName);
+    vector<BroadphasePair> pairs;
+    NarrowPhase narrowPhase(pool);
+    IslandSolver islandSolver(pool);
+
+    long totalPairs = 0;
+    long totalContacts = 0;
+    double seconds = 0;
+    for (int s = 0; s < steps; s++)
+    {
+        World.beginStep(0.02f);
+        auto start = chrono::high_resolution_clock::now();
+        broadphase->findPairs(objects, pairs);
+        narrowPhase.run(objects, pairs);
+        seconds += chrono::duration<double>(chrono::high_resolution_clock::now() - start).count();
+
+        // counted outside the timing
+        totalPairs += pairs.size();
+        totalContacts += World.contacts.size();
+
+        start = chrono::high_resolution_clock::now();
+        World.applyGravity();
+        islandSolver.update(objects);
+        World.integrate(*broadphase);
+        seconds += chrono::duration<double>(chrono::high_resolution_clock::now() - start).count();
+    }
+
+    const PhysicsStats &stats = World.getStats();
+    printf("%-7s %4d bodies %5d steps %12.0f ns/step %8.1f pairs/step %8.1f contacts/step %4d asleep  checksum %016llx\n",
+        sceneNames[scene], stats.bodies, steps, seconds * 1e9 / steps, (double)totalPairs / steps,
+        (double)totalContacts / steps, stats.sleeping, checksum(objects));
+    if (!columns.empty())
+    {
+        int standing = 0;
+        for (const Column &column : columns)
+        {
+            standing += column.standing();
+        }
+        printf("        %d / %d columns standing\n", standing, (int)columns.size());
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    string resourceDir = argc >= 2 ? argv[1] : "../resources";
+    string sceneName = argc >= 3 ? argv[2] : "all";
+    int steps = argc >= 4 ? atoi(argv[3]) : 500;
+    int threads = argc >= 5 ? atoi(argv[4]) : 0;
+    string broadphaseName = argc >= 6 ? argv[5] : "tree";
+    if (argc >= 7)
+    {
+        World.solverIterations = atoi(argv[6]);
+    }
+
+    Models models;
+    models.cube = loadModel(resourceDir, "cube.obj");
+    models.sphere = loadModel(resourceDir, "sphere.obj");
+    if (models.cube == nullptr || models.sphere == nullptr)
+    {
+        return 1;
+    }
+
+    auto pool = make_shared<WorkerPool>(threads);
+    printf("%d threads, %s broadphase, %d solver iterations\n", pool->getNumThreads(), broadphaseName.c_str(), World.solverIterations);
+
+    bool found = false;
+    for (int scene = 0; scene < (int)(sizeof(sceneNames) / sizeof(sceneNames[0])); scene++)
+    {
+        if (sceneName == "all" || sceneName == sceneNames[scene])
+        {
+            runScene(scene, models, steps, pool, broadphaseName);
+            found = true;
+        }
+    }
+    if (!found)
+    {
+        cerr << "unknown scene " << sceneName << endl;
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,364 @@
+/*
+ * Checks and measures ColliderSDF.
+ * The grid is baked with and without a WorkerPool, which have to give the same
+ * distances, then written to a cache file and read back, which has to give them
+ * again. A cache baked at another resolution, or from the mesh before one of its
+ * vertices moved, has to be baked again.
+ *
+ * Distances are compared with the distance to the nearest of every triangle. The
+ * grid is exact at its points and the distance changes by at most the distance
+ * moved, so anywhere inside the grid they can only be off by the distance to the
+ * cell's corners, sqrt(3) / 2 cells. Sphere contacts and sweeps are compared with
+ * checkSphereMesh and sweepSphereMesh on the same mesh with the same tolerance.
+ * The normals are only compared where the mesh is smooth under the sphere.
+ * Exits with 1 if anything doesn't match.
+ *
+ * usage: SDFBench [resource dir] [model] [resolution] [threads]
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <string>
+
+#include "../src/physics/PhysicsObject.h"
+#include "../src/physics/ColliderSphere.h"
+#include "../src/physics/ColliderMesh.h"
+#include "../src/physics/ColliderSDF.h"
+#include "BenchUtil.h"
+
+using namespace std;
+using namespace glm;
+
+static double secondsSince(chrono::high_resolution_clock::time_point start)
+{
+    return chrono::duration<double>(chrono::high_resolution_clock::now() - start).count();
+}
+
+static vec3 randomDirection()
+{
+    return normalize(vec3(rand() % 2001 - 1000, rand() % 2001 - 1000, rand() % 2001 - 1000) + 0.001f);
+}
+
+// Distance from a point in mesh space to the nearest of every triangle
+static float bruteForceDistance(Shape *shape, const vec3 &p)
+{
+    mat4 I(1.f);
+    float best = INFINITY;
+    for (int i = 0; i < shape->getNumFaces(); i++)
+    {
+        vec3 v[3];
+        shape->getFace(i, I, v);
+        vec3 closest;
+        int feature;
+        closestPointOnTriangle(p, v[0], v[1], v[2], closest, feature);
+        best = std::min(best, distance(p, closest));
+    }
+    return best;
+}
+
+// A copy of shape with one vertex that isn't on its bounds moved towards the
+// center, so the counts and bounds stay the same
+static shared_ptr<Shape> moveOneVertex(Shape &shape)
+{
+    tinyobj::shape_t copy;
+    int moved = -1;
+    for (int i = 0; i < shape.getNumVertices(); i++)
+    {
+        vec3 v = shape.getLocalVertex(i);
+        if (moved == -1 && all(greaterThan(v, shape.min)) && all(lessThan(v, shape.max)))
+        {
+            v += (shape.center - v) * 0.25f;
+            moved = i;
+        }
+        copy.mesh.positions.insert(copy.mesh.positions.end(), {v.x, v.y, v.z});
+    }
+    for (int i = 0; i < shape.getNumFaces(); i++)
+    {
+        for (int j = 0; j < 3; j++)
+        {
+            copy.mesh.indices.push_back(shape.getFaceIndex(i, j));
+        }
+    }
+    auto edited = make_shared<Shape>();
+    edited->createShape(copy);
+    edited->measure();
+    return edited;
+}
+
+// Number of points where the two grids give different distances
+static int compareGrids(const ColliderSDF &a, const ColliderSDF &b, const vector<vec3> &points)
+{
+    int different = 0;
+    for (const vec3 &p : points)
+    {
+        vec3 gradientA, gradientB;
+        if (a.getDistance(p, gradientA) != b.getDistance(p, gradientB) || gradientA != gradientB)
+        {
+            different++;
+        }
+    }
+    return different;
+}
+
+static int getDeepest(const vector<Collision> &contacts)
+{
+    int deepest = 0;
+    for (int i = 1; i < (int)contacts.size(); i++)
+    {
+        if (contacts[i].penetration > contacts[deepest].penetration)
+        {
+            deepest = i;
+        }
+    }
+    return deepest;
+}
+
+int main(int argc, char *argv[])
+{
+    string resourceDir = argc >= 2 ? argv[1] : "../resources";
+    string model = argc >= 3 ? argv[2] : "bunny.obj";
+    int resolution = argc >= 4 ? atoi(argv[3]) : 48;
+    int threads = argc >= 5 ? atoi(argv[4]) : 0;
+
+    auto shape = make_shared<Shape>();
+    shape->loadMesh(resourceDir + "/models/" + model);
+    if (shape->getNumFaces() == 0)
+    {
+        cerr << "could not load " << model << endl;
+        return 1;
+    }
+    shape->resize();
+    shape->measure();
+    auto meshCol = make_shared<ColliderMesh>(shape);
+
+    vec3 extent = shape->max - shape->min;
+    float cellSize = std::max(extent.x, std::max(extent.y, extent.z)) / resolution;
+    float tolerance = cellSize * 0.866f + 1e-4f;
+    printf("%s: %d faces, resolution %d, cells %.4f across\n", model.c_str(), shape->getNumFaces(), resolution, cellSize);
+    int bad = 0;
+
+    // baking, on one thread and on the pool
+    auto start = chrono::high_resolution_clock::now();
+    auto sdf = make_shared<ColliderSDF>(shape, resolution);
+    double bakeTime = secondsSince(start);
+    auto pool = make_shared<WorkerPool>(threads);
+    start = chrono::high_resolution_clock::now();
+    ColliderSDF pooled(shape, resolution, "", pool);
+    double pooledTime = secondsSince(start);
+
+    srand(572);
+    vector<vec3> points;
+    for (int i = 0; i < 2000; i++)
+    {
+        points.push_back(shape->min + (shape->max - shape->min) * vec3(randomRange(0, 1), randomRange(0, 1), randomRange(0, 1)));
+    }
+    int poolDifferent = compareGrids(*sdf, pooled, points);
+    bad += poolDifferent;
+    printf("  bake:    %8.3f s, %8.3f s on %d threads  (%d points different)\n",
+        bakeTime, pooledTime, pool->getNumThreads(), poolDifferent);
+
+    // the cache file, written by the first one and read by the second
+    string cacheFile = "SDFBench.cache";
+    remove(cacheFile.c_str());
+    start = chrono::high_resolution_clock::now();
+    ColliderSDF saved(shape, resolution, cacheFile, pool);
+    double saveTime = secondsSince(start);
+    bool written = ifstream(cacheFile, ios::binary).good();
+    start = chrono::high_resolution_clock::now();
+    ColliderSDF loaded(shape, resolution, cacheFile, pool);
+    double loadTime = secondsSince(start);
+    int cacheDifferent = compareGrids(*sdf, loaded, points);
+    // a different resolution can't use the file, so it's baked again
+    ColliderSDF coarse(shape, resolution / 2, cacheFile, pool);
+    ColliderSDF coarseBaked(shape, resolution / 2);
+    int coarseDifferent = compareGrids(coarse, coarseBaked, points);
+    // and neither can the mesh after an edit that keeps its counts and bounds
+    ColliderSDF resaved(shape, resolution, cacheFile, pool);
+    shared_ptr<Shape> edited = moveOneVertex(*shape);
+    ColliderSDF editedCached(edited, resolution, cacheFile, pool);
+    ColliderSDF editedBaked(edited, resolution);
+    int editedDifferent = compareGrids(editedCached, editedBaked, points);
+    remove(cacheFile.c_str());
+    bad += !written + cacheDifferent + coarseDifferent + editedDifferent;
+    printf("  cache:   %8.3f s to bake and save, %8.3f s to load  (%s, %d points different, %d at resolution %d, %d after an edit)\n",
+        saveTime, loadTime, written ? "written" : "not written", cacheDifferent, coarseDifferent, resolution / 2, editedDifferent);
+
+    // distances
+    int wrongDistance = 0;
+    float worst = 0;
+    for (const vec3 &p : points)
+    {
+        vec3 gradient;
+        float error = fabs(fabs(sdf->getDistance(p, gradient)) - bruteForceDistance(shape.get(), p));
+        worst = std::max(worst, error);
+        wrongDistance += error > tolerance;
+    }
+    bad += wrongDistance;
+    printf("  distance: %zu points, %d off by more than %.4f  (at most %.2f cells)\n",
+        points.size(), wrongDistance, tolerance, worst / cellSize);
+
+    // spheres against the mesh scaled up by 4, pushed in from outside until they
+    // touch it, then up to 0.1 further
+    float scale = 4;
+    float worldTolerance = tolerance * scale;
+    auto mesh = make_shared<PhysicsObject>(vec3(0), quat(1, 0, 0, 0), vec3(scale), nullptr, meshCol);
+    auto field = make_shared<PhysicsObject>(vec3(0), quat(1, 0, 0, 0), vec3(scale), nullptr, sdf);
+    auto sphereCol = make_shared<ColliderSphere>(0.25f);
+    auto sphere = make_shared<PhysicsObject>(vec3(0), nullptr, sphereCol);
+    ColliderMesh *mc = meshCol.get();
+    ColliderSDF *fc = sdf.get();
+    float radius = sphere->getRadius();
+
+    vector<vec3> touching;
+    vector<vec3> directions;
+    while (touching.size() < 2000)
+    {
+        vec3 dir = randomDirection();
+        for (float t = 6.0f; t > 0; t -= 0.01f)
+        {
+            sphere->position = dir * t;
+            checkSphereMesh(sphere.get(), sphereCol.get(), mesh.get(), mc);
+            bool hit = World.contacts.size() > 0;
+            World.contacts.clear();
+            if (hit)
+            {
+                touching.push_back(dir * t);
+                directions.push_back(dir);
+                break;
+            }
+        }
+    }
+    vector<vec3> positions;
+    for (size_t i = 0; i < touching.size(); i++)
+    {
+        positions.push_back(touching[i] - directions[i] * randomRange(0, 0.1f));
+    }
+
+    int missed = 0;
+    int wrongDepth = 0;
+    int wrongNormal = 0;
+    int smooth = 0;
+    vector<Collision> meshContacts, sdfContacts;
+    for (const vec3 &p : positions)
+    {
+        sphere->position = p;
+        checkSphereMesh(sphere.get(), sphereCol.get(), mesh.get(), mc);
+        takeContacts(meshContacts);
+        checkSphereSDF(sphere.get(), sphereCol.get(), field.get(), fc);
+        takeContacts(sdfContacts);
+        float meshDepth = meshContacts.empty() ? 0 : meshContacts[getDeepest(meshContacts)].penetration;
+        float sdfDepth = sdfContacts.empty() ? 0 : sdfContacts[0].penetration;
+        if (meshContacts.empty() != sdfContacts.empty())
+        {
+            // only a miss if it wasn't about to touch anyway
+            missed += std::max(meshDepth, sdfDepth) > worldTolerance;
+            continue;
+        }
+        if (meshContacts.empty())
+        {
+            continue;
+        }
+        wrongDepth += fabs(meshDepth - sdfDepth) > worldTolerance;
+
+        // the mesh is smooth here if every contact near as deep points about the same way
+        const Collision &deepest = meshContacts[getDeepest(meshContacts)];
+        bool flat = true;
+        for (const Collision &c : meshContacts)
+        {
+            flat = flat && (c.penetration < deepest.penetration - worldTolerance || dot(c.normal, deepest.normal) > 0.985f);
+        }
+        if (flat)
+        {
+            smooth++;
+            wrongNormal += dot(sdfContacts[0].normal, deepest.normal) < 0.9f;
+        }
+    }
+    bad += missed + wrongDepth + wrongNormal;
+
+    int rounds = 20;
+    double meshTime = 0, sdfTime = 0;
+    for (int r = 0; r < rounds; r++)
+    {
+        start = chrono::high_resolution_clock::now();
+        for (const vec3 &p : positions)
+        {
+            sphere->position = p;
+            checkSphereMesh(sphere.get(), sphereCol.get(), mesh.get(), mc);
+            World.contacts.clear();
+        }
+        meshTime += secondsSince(start);
+        start = chrono::high_resolution_clock::now();
+        for (const vec3 &p : positions)
+        {
+            sphere->position = p;
+            checkSphereSDF(sphere.get(), sphereCol.get(), field.get(), fc);
+            World.contacts.clear();
+        }
+        sdfTime += secondsSince(start);
+    }
+    long calls = (long)positions.size() * rounds;
+    printf("  contacts: %8.1f ns/test, mesh %8.1f ns/test  (%d missed, %d wrong depth, %d of %d smooth normals off by over 25 degrees)\n",
+        sdfTime * 1e9 / calls, meshTime * 1e9 / calls, missed, wrongDepth, wrongNormal, smooth);
+
+    // sweeps from outside the mesh to 0.3 past where the sphere first touches it.
+    // Both stop at radius * 0.95 from the surface, so where the SDF stops the
+    // distance to the nearest triangle has to be that.
+    int sweepMissed = 0;
+    int wrongStop = 0;
+    float skin = radius * 0.95f;
+    vector<vec3> starts;
+    vector<vec3> ends;
+    for (size_t i = 0; i < touching.size(); i++)
+    {
+        starts.push_back(directions[i] * 8.0f);
+        ends.push_back(touching[i] - directions[i] * 0.3f);
+    }
+    for (size_t i = 0; i < starts.size(); i++)
+    {
+        sphere->position = ends[i];
+        float tMesh = sweepSphereMesh(sphere.get(), sphereCol.get(), starts[i], mesh.get(), mc);
+        float tSDF = sweepSphereSDF(sphere.get(), sphereCol.get(), starts[i], field.get(), fc);
+        if (tMesh >= 1 || tSDF >= 1)
+        {
+            sweepMissed++;
+            continue;
+        }
+        vec3 stop = mix(starts[i], ends[i], tSDF);
+        float d = bruteForceDistance(shape.get(), stop / scale) * scale;
+        wrongStop += fabs(d - skin) > worldTolerance;
+    }
+    bad += sweepMissed + wrongStop;
+
+    meshTime = 0;
+    sdfTime = 0;
+    for (int r = 0; r < rounds; r++)
+    {
+        start = chrono::high_resolution_clock::now();
+        for (size_t i = 0; i < starts.size(); i++)
+        {
+            sphere->position = ends[i];
+            sweepSphereMesh(sphere.get(), sphereCol.get(), starts[i], mesh.get(), mc);
+        }
+        meshTime += secondsSince(start);
+        start = chrono::high_resolution_clock::now();
+        for (size_t i = 0; i < starts.size(); i++)
+        {
+            sphere->position = ends[i];
+            sweepSphereSDF(sphere.get(), sphereCol.get(), starts[i], field.get(), fc);
+        }
+        sdfTime += secondsSince(start);
+    }
+    calls = (long)starts.size() * rounds;
+    printf("  sweeps:   %8.1f ns/test, mesh %8.1f ns/test  (%d missed, %d stopped the wrong distance from the mesh)\n",
+        sdfTime * 1e9 / calls, meshTime * 1e9 / calls, sweepMissed, wrongStop);
+
+    if (bad > 0)
+    {
+        printf("%d checks failed!\n", bad);
+        return 1;
+    }
+    return 0;
+}
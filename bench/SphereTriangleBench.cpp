@@ -0,0 +1,144 @@
+/*
+ * Measures the sphere vs triangle kernels used by checkSphereMesh.
+ * Every supported kernel is run over the same leaves of the mesh BVH and
+ * must find exactly the same contacts as the scalar one.
+ *
+ * usage: SphereTriangleBench [resource dir] [model]
+ */
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+
+#include "../src/physics/PhysicsObject.h"
+#include "../src/physics/ColliderSphere.h"
+#include "../src/physics/ColliderMesh.h"
+#include "../src/physics/SphereTriangleKernel.h"
+#include "BenchUtil.h"
+
+using namespace std;
+using namespace glm;
+
+static const char *kernelNames[] = {"scalar", "sse", "avx2"};
+
+static bool sameContacts(const vector<Collision> &a, const vector<Collision> &b)
+{
+    if (a.size() != b.size())
+    {
+        return false;
+    }
+    for (size_t i = 0; i < a.size(); i++)
+    {
+        if (a[i].geom != b[i].geom || a[i].pos != b[i].pos || a[i].normal != b[i].normal || a[i].penetration != b[i].penetration)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+int main(int argc, char *argv[])
+{
+    string resourceDir = argc >= 2 ? argv[1] : "../resources";
+    string model = argc >= 3 ? argv[2] : "bunny.obj";
+
+    auto shape = make_shared<Shape>();
+    shape->loadMesh(resourceDir + "/models/" + model);
+    if (shape->getNumFaces() == 0)
+    {
+        cerr << "could not load " << model << endl;
+        return 1;
+    }
+    shape->resize();
+    shape->measure();
+
+    auto meshCol = make_shared<ColliderMesh>(shape);
+    auto mesh = make_shared<PhysicsObject>(vec3(0.5f, 0, 0), rotate(quat(1, 0, 0, 0), 0.6f, normalize(vec3(1, 1, 0))), vec3(4, 3, 4), shape, meshCol);
+    auto sphereCol = make_shared<ColliderSphere>(1.0f);
+    auto sphere = make_shared<PhysicsObject>(vec3(0), nullptr, sphereCol);
+    mat4 M = translate(mat4(1.f), mesh->position) * mat4_cast(mesh->orientation) * scale(mat4(1.f), mesh->scale);
+
+    // spheres of different sizes scattered around the mesh
+    srand(911);
+    vector<vec4> spheres;
+    for (int i = 0; i < 5000; i++)
+    {
+        vec3 pos = vec3(rand() % 2001 - 1000, rand() % 2001 - 1000, rand() % 2001 - 1000) / 400.0f;
+        spheres.push_back(vec4(mesh->position + pos, 0.05f + (rand() % 1000) / 2000.0f));
+    }
+
+    // leaves each sphere's bounds overlap, so the kernels are timed on their own
+    vector<vector<int>> ranges(spheres.size());
+    long triangles = 0;
+    for (size_t i = 0; i < spheres.size(); i++)
+    {
+        vec3 center = vec3(spheres[i]);
+        vec3 localCenter = (inverse(mesh->orientation) * (center - mesh->position)) / mesh->scale;
+        vec3 localExtent = spheres[i].w / abs(mesh->scale);
+        shape->bvh.queryLeaves(localCenter - localExtent, localCenter + localExtent, ranges[i]);
+        for (size_t j = 0; j < ranges[i].size(); j += 2)
+        {
+            triangles += ranges[i][j + 1];
+        }
+    }
+
+    SimdKernel best = getSphereTriangleKernel();
+    printf("%s: %d faces, %zu spheres, %ld triangle tests per round\n", model.c_str(), shape->getNumFaces(), spheres.size(), triangles);
+
+    vector<vector<Collision>> expected(spheres.size());
+    vector<Collision> made;
+    vector<int> hits(shape->getNumFaces());
+    bool ok = true;
+    for (int k = KERNEL_SCALAR; k <= KERNEL_AVX2; k++)
+    {
+        SimdKernel kernel = (SimdKernel)k;
+        if (!setSphereTriangleKernel(kernel))
+        {
+            printf("  %-7s not supported\n", kernelNames[k]);
+            continue;
+        }
+
+        // contacts have to match the scalar kernel exactly
+        long contacts = 0;
+        int mismatches = 0;
+        for (size_t i = 0; i < spheres.size(); i++)
+        {
+            sphere->position = vec3(spheres[i]);
+            sphere->scale = vec3(spheres[i].w);
+            checkSphereMesh(sphere.get(), sphereCol.get(), mesh.get(), meshCol.get());
+            takeContacts(made);
+            if (kernel == KERNEL_SCALAR)
+            {
+                expected[i] = made;
+            }
+            else if (!sameContacts(expected[i], made))
+            {
+                mismatches++;
+            }
+            contacts += made.size();
+        }
+        ok = ok && mismatches == 0;
+
+        int rounds = 20;
+        long found = 0;
+        auto start = chrono::steady_clock::now();
+        for (int r = 0; r < rounds; r++)
+        {
+            for (size_t i = 0; i < spheres.size(); i++)
+            {
+                for (size_t j = 0; j < ranges[i].size(); j += 2)
+                {
+                    found += findSphereTriangles(meshCol->triangles, ranges[i][j], ranges[i][j + 1], M, vec3(spheres[i]), spheres[i].w, &hits[0]);
+                }
+            }
+        }
+        double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+        printf("  %-7s %8.2f ns/triangle %12.0f triangles/s (%ld hits, %ld contacts, %d mismatches)\n", kernelNames[k],
+            seconds * 1e9 / (triangles * rounds), triangles * rounds / seconds, found / rounds, contacts, mismatches);
+    }
+    setSphereTriangleKernel(best);
+
+    return ok ? 0 : 1;
+}
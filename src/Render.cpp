@@ -0,0 +1,20 @@
+#include "Render.h"
+
+#include <glm/gtc/type_ptr.hpp>
+
+using namespace std;
+using namespace glm;
+
+void drawObject(shared_ptr<Program> prog, shared_ptr<MatrixStack> M, GameObject *obj)
+{
+    if (obj->model != NULL && (obj->inView || !GameObject::cull) && !obj->hidden)
+    {
+        M->pushMatrix();
+            M->translate(obj->getRenderPosition());
+            M->rotate(obj->getRenderOrientation());
+            M->scale(obj->scale);
+            glUniformMatrix4fv(prog->getUniform("M"), 1, GL_FALSE, value_ptr(M->topMatrix()));
+            obj->model->draw(prog);
+        M->popMatrix();
+    }
+}
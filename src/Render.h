@@ -0,0 +1,11 @@
+#pragma once
+
+#include <memory>
+
+#include "Program.h"
+#include "MatrixStack.h"
+#include "physics/GameObject.h"
+
+// The GL side of GameObject. Draws obj's model at its render position and
+// orientation, unless it's hidden or culled.
+void drawObject(std::shared_ptr<Program> prog, std::shared_ptr<MatrixStack> M, GameObject *obj);
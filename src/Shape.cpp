@@ -1,10 +1,8 @@
 #include "Shape.h"
 #include <iostream>
 #include <assert.h>
-#include <unordered_set>
-
-#include "GLSL.h"
-#include "Program.h"
+#include <algorithm>
+#include <unordered_map>
 
 using namespace std;
 using namespace glm;
@@ -51,6 +49,37 @@ int Shape::getNumEdges()
 	return (int)(edgeBuffer.size() / 2);
 }
 
+unsigned int Shape::getFaceIndex(int i, int j)
+{
+	return eleBuf[i * 3 + j];
+}
+
+unsigned int Shape::getFaceVertexId(int i, int j)
+{
+	return weldBuf[eleBuf[i * 3 + j]];
+}
+
+void Shape::getFace(int i, const mat4 &M, vec3 face[3]) const
+{
+	for (int j = 0; j < 3; j++)
+	{
+		face[j] = vec3(M * vec4(getLocalVertex(eleBuf[i * 3 + j]), 1.0f));
+	}
+}
+
+void Shape::getEdge(int i, const mat4 &M, vec3 edge[2]) const
+{
+	for (int j = 0; j < 2; j++)
+	{
+		edge[j] = vec3(M * vec4(getLocalVertex(edgeBuffer[i * 2 + j]), 1.0f));
+	}
+}
+
+vec3 Shape::getLocalVertex(unsigned int i) const
+{
+	return vec3(posBuf[i * 3], posBuf[i * 3 + 1], posBuf[i * 3 + 2]);
+}
+
 typedef pair<unsigned int, unsigned int> vert_pair;
 struct pair_hash
 {
@@ -63,23 +92,49 @@ struct pair_hash
 
 void Shape::findEdges()
 {
-	unordered_set<vert_pair, pair_hash> edgeSet;
+	// Vertices are duplicated where normals or texture coordinates differ. Give all
+	// copies of a position the same id so collision sees the mesh as connected.
+	int numVertices = getNumVertices();
+	vector<unsigned int> order(numVertices);
+	for (int i = 0; i < numVertices; i++)
+	{
+		order[i] = i;
+	}
+	sort(order.begin(), order.end(), [&](unsigned int a, unsigned int b)
+	{
+		vec3 pa = getLocalVertex(a);
+		vec3 pb = getLocalVertex(b);
+		return pa.x < pb.x || (pa.x == pb.x && (pa.y < pb.y || (pa.y == pb.y && (pa.z < pb.z || (pa.z == pb.z && a < b)))));
+	});
+	weldBuf.resize(numVertices);
+	for (int i = 0; i < numVertices; i++)
+	{
+		bool same = i > 0 && getLocalVertex(order[i]) == getLocalVertex(order[i - 1]);
+		weldBuf[order[i]] = same ? weldBuf[order[i - 1]] : order[i];
+	}
+
+	unordered_map<vert_pair, unsigned int, pair_hash> edgeMap;
+	edgeBuffer.clear();
+	faceEdges.resize(eleBuf.size());
 	for (int i = 0; i < eleBuf.size() / 3; i++)
 	{
 		for (int j = 0; j < 3; j++)
 		{
-			unsigned int v1 = eleBuf[i * 3 + j];
-			unsigned int v2 = eleBuf[i * 3 + ((j + 1) % 3)];
+			unsigned int v1 = weldBuf[eleBuf[i * 3 + j]];
+			unsigned int v2 = weldBuf[eleBuf[i * 3 + ((j + 1) % 3)]];
 			vert_pair pair = make_pair((std::min)(v1, v2), (std::max)(v1, v2));
-			edgeSet.insert(pair);
+			auto edge = edgeMap.find(pair);
+			if (edge == edgeMap.end())
+			{
+				edge = edgeMap.insert(make_pair(pair, (unsigned int)(edgeBuffer.size() / 2))).first;
+				edgeBuffer.push_back(pair.first);
+				edgeBuffer.push_back(pair.second);
+			}
+			faceEdges[i * 3 + j] = edge->second;
 		}
 	}
 
-	for (vert_pair pair : edgeSet)
-	{
-		edgeBuffer.push_back(pair.first);
-		edgeBuffer.push_back(pair.second);
-	}
+	bvh.build(posBuf, eleBuf);
 }
 
 void Shape::calcNormals()
@@ -276,92 +331,3 @@ void Shape::createShape(tinyobj::shape_t & shape)
 		texBuf = shape.mesh.texcoords;
 		eleBuf = shape.mesh.indices;
 }
-
-void Shape::init()
-{
-   // Initialize the vertex array object
-   glGenVertexArrays(1, &vaoID);
-   glBindVertexArray(vaoID);
-
-	// Send the position array to the GPU
-	glGenBuffers(1, &posBufID);
-	glBindBuffer(GL_ARRAY_BUFFER, posBufID);
-	glBufferData(GL_ARRAY_BUFFER, posBuf.size()*sizeof(float), &posBuf[0], GL_STATIC_DRAW);
-	
-	// Send the normal array to the GPU
-	if(norBuf.empty()) {
-		norBufID = 0;
-	} else {
-		glGenBuffers(1, &norBufID);
-		glBindBuffer(GL_ARRAY_BUFFER, norBufID);
-		glBufferData(GL_ARRAY_BUFFER, norBuf.size()*sizeof(float), &norBuf[0], GL_STATIC_DRAW);
-	}
-	
-	// Send the texture array to the GPU
-	if(texBuf.empty()) {
-		texBufID = 0;
-	} else {
-		glGenBuffers(1, &texBufID);
-		glBindBuffer(GL_ARRAY_BUFFER, texBufID);
-		glBufferData(GL_ARRAY_BUFFER, texBuf.size()*sizeof(float), &texBuf[0], GL_STATIC_DRAW);
-	}
-	
-	// Send the element array to the GPU
-	glGenBuffers(1, &eleBufID);
-	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, eleBufID);
-	glBufferData(GL_ELEMENT_ARRAY_BUFFER, eleBuf.size()*sizeof(unsigned int), &eleBuf[0], GL_STATIC_DRAW);
-	
-	// Unbind the arrays
-	glBindBuffer(GL_ARRAY_BUFFER, 0);
-	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
-	
-	assert(glGetError() == GL_NO_ERROR);
-}
-
-void Shape::draw(const shared_ptr<Program> prog) const
-{
-	int h_pos, h_nor, h_tex;
-	h_pos = h_nor = h_tex = -1;
-
-   glBindVertexArray(vaoID);
-	// Bind position buffer
-	h_pos = prog->getAttribute("vertPos");
-	GLSL::enableVertexAttribArray(h_pos);
-	glBindBuffer(GL_ARRAY_BUFFER, posBufID);
-	glVertexAttribPointer(h_pos, 3, GL_FLOAT, GL_FALSE, 0, (const void *)0);
-	
-	// Bind normal buffer
-	h_nor = prog->getAttribute("vertNor");
-	if(h_nor != -1 && norBufID != 0) {
-		GLSL::enableVertexAttribArray(h_nor);
-		glBindBuffer(GL_ARRAY_BUFFER, norBufID);
-		glVertexAttribPointer(h_nor, 3, GL_FLOAT, GL_FALSE, 0, (const void *)0);
-	}
-
-	if (texBufID != 0) {	
-		// Bind texcoords buffer
-		h_tex = prog->getAttribute("vertTex");
-		if(h_tex != -1 && texBufID != 0) {
-			GLSL::enableVertexAttribArray(h_tex);
-			glBindBuffer(GL_ARRAY_BUFFER, texBufID);
-			glVertexAttribPointer(h_tex, 2, GL_FLOAT, GL_FALSE, 0, (const void *)0);
-		}
-	}
-	
-	// Bind element buffer
-	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, eleBufID);
-	
-	// Draw
-	glDrawElements(GL_TRIANGLES, (int)eleBuf.size(), GL_UNSIGNED_INT, (const void *)0);
-	
-	// Disable and unbind
-	if(h_tex != -1) {
-		GLSL::disableVertexAttribArray(h_tex);
-	}
-	if(h_nor != -1) {
-		GLSL::disableVertexAttribArray(h_nor);
-	}
-	GLSL::disableVertexAttribArray(h_pos);
-	glBindBuffer(GL_ARRAY_BUFFER, 0);
-	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
-}
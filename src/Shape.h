@@ -8,6 +8,8 @@
 #include <glm/gtc/type_ptr.hpp>
 #include <tiny_obj_loader/tiny_obj_loader.h>
 
+#include "physics/TriangleBVH.h"
+
 class Program;
 
 class Shape
@@ -16,7 +18,7 @@ public:
 	Shape();
 	virtual ~Shape();
 	void createShape(tinyobj::shape_t & shape);
-	void init();
+	void init(); // init and draw are in ShapeRender.cpp and need GL
 	void measure();
 	void draw(const std::shared_ptr<Program> prog) const;
 	glm::vec3 min;
@@ -34,10 +36,19 @@ public:
 	int getNumVertices();
 	std::vector<glm::vec3> getEdge(int i, const glm::mat4 &M);
 	int getNumEdges();
-	std::vector<unsigned int> edgeBuffer;
+	unsigned int getFaceIndex(int i, int j); // index of vertex j of face i
+	unsigned int getFaceVertexId(int i, int j); // same, but shared by all copies of a position, built by findEdges
+	// Non-allocating versions for the physics code, these write into the given arrays
+	void getFace(int i, const glm::mat4 &M, glm::vec3 face[3]) const;
+	void getEdge(int i, const glm::mat4 &M, glm::vec3 edge[2]) const;
+	glm::vec3 getLocalVertex(unsigned int i) const;
+	std::vector<unsigned int> edgeBuffer; // pairs of welded vertex ids
+	std::vector<unsigned int> faceEdges; // indices of the 3 edges of each face, built by findEdges
+	TriangleBVH bvh; // local space triangle hierarchy, built by findEdges
 	
 private:
 	std::vector<unsigned int> eleBuf;
+	std::vector<unsigned int> weldBuf; // first vertex with the same position as each vertex
 	std::vector<float> posBuf;
 	std::vector<float> norBuf;
 	std::vector<float> texBuf;
@@ -0,0 +1,97 @@
+// The GL half of Shape, built with the app rather than the physics library
+#include "Shape.h"
+#include <assert.h>
+
+#include "GLSL.h"
+#include "Program.h"
+
+using namespace std;
+
+void Shape::init()
+{
+   // Initialize the vertex array object
+   glGenVertexArrays(1, &vaoID);
+   glBindVertexArray(vaoID);
+
+	// Send the position array to the GPU
+	glGenBuffers(1, &posBufID);
+	glBindBuffer(GL_ARRAY_BUFFER, posBufID);
+	glBufferData(GL_ARRAY_BUFFER, posBuf.size()*sizeof(float), &posBuf[0], GL_STATIC_DRAW);
+	
+	// Send the normal array to the GPU
+	if(norBuf.empty()) {
+		norBufID = 0;
+	} else {
+		glGenBuffers(1, &norBufID);
+		glBindBuffer(GL_ARRAY_BUFFER, norBufID);
+		glBufferData(GL_ARRAY_BUFFER, norBuf.size()*sizeof(float), &norBuf[0], GL_STATIC_DRAW);
+	}
+	
+	// Send the texture array to the GPU
+	if(texBuf.empty()) {
+		texBufID = 0;
+	} else {
+		glGenBuffers(1, &texBufID);
+		glBindBuffer(GL_ARRAY_BUFFER, texBufID);
+		glBufferData(GL_ARRAY_BUFFER, texBuf.size()*sizeof(float), &texBuf[0], GL_STATIC_DRAW);
+	}
+	
+	// Send the element array to the GPU
+	glGenBuffers(1, &eleBufID);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, eleBufID);
+	glBufferData(GL_ELEMENT_ARRAY_BUFFER, eleBuf.size()*sizeof(unsigned int), &eleBuf[0], GL_STATIC_DRAW);
+	
+	// Unbind the arrays
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+	
+	assert(glGetError() == GL_NO_ERROR);
+}
+
+void Shape::draw(const shared_ptr<Program> prog) const
+{
+	int h_pos, h_nor, h_tex;
+	h_pos = h_nor = h_tex = -1;
+
+   glBindVertexArray(vaoID);
+	// Bind position buffer
+	h_pos = prog->getAttribute("vertPos");
+	GLSL::enableVertexAttribArray(h_pos);
+	glBindBuffer(GL_ARRAY_BUFFER, posBufID);
+	glVertexAttribPointer(h_pos, 3, GL_FLOAT, GL_FALSE, 0, (const void *)0);
+	
+	// Bind normal buffer
+	h_nor = prog->getAttribute("vertNor");
+	if(h_nor != -1 && norBufID != 0) {
+		GLSL::enableVertexAttribArray(h_nor);
+		glBindBuffer(GL_ARRAY_BUFFER, norBufID);
+		glVertexAttribPointer(h_nor, 3, GL_FLOAT, GL_FALSE, 0, (const void *)0);
+	}
+
+	if (texBufID != 0) {	
+		// Bind texcoords buffer
+		h_tex = prog->getAttribute("vertTex");
+		if(h_tex != -1 && texBufID != 0) {
+			GLSL::enableVertexAttribArray(h_tex);
+			glBindBuffer(GL_ARRAY_BUFFER, texBufID);
+			glVertexAttribPointer(h_tex, 2, GL_FLOAT, GL_FALSE, 0, (const void *)0);
+		}
+	}
+	
+	// Bind element buffer
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, eleBufID);
+	
+	// Draw
+	glDrawElements(GL_TRIANGLES, (int)eleBuf.size(), GL_UNSIGNED_INT, (const void *)0);
+	
+	// Disable and unbind
+	if(h_tex != -1) {
+		GLSL::disableVertexAttribArray(h_tex);
+	}
+	if(h_nor != -1) {
+		GLSL::disableVertexAttribArray(h_nor);
+	}
+	GLSL::disableVertexAttribArray(h_pos);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+}
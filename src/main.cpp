@@ -47,14 +47,26 @@
 #include "MatrixStack.h"
 #include "WindowManager.h"
 #include "Time.h"
+#include "Render.h"
 #include "physics/PhysicsObject.h"
 #include "physics/ColliderSphere.h"
 #include "physics/ColliderMesh.h"
+#include "physics/ColliderBox.h"
+#include "physics/SweepAndPrune.h"
+#include "physics/SpatialHash.h"
+#include "physics/AABBTree.h"
+#include "physics/NarrowPhase.h"
+#include "physics/IslandSolver.h"
 #include "Constants.h"
 #include "Spider.h"
 #include "ShaderManager.h"
 #include "Spline.h"
 
+// Most physics steps to run in one frame. If a frame takes longer than this many
+// steps the rest is dropped and the simulation slows down, instead of every frame
+// falling further behind.
+#define MAX_PHYSICS_STEPS 5
+
 #define TINYOBJLOADER_IMPLEMENTATION
 #include <tiny_obj_loader/tiny_obj_loader.h>
 
@@ -83,6 +95,11 @@ public:
 	vector<shared_ptr<Shape>> minecraftSpiderShapes;
 
 	vector<shared_ptr<PhysicsObject>> physicsObjects;
+	shared_ptr<Broadphase> broadphase = make_shared<AABBTree>();
+	vector<BroadphasePair> broadphasePairs;
+	shared_ptr<WorkerPool> physicsWorkers = make_shared<WorkerPool>();
+	NarrowPhase narrowPhase{physicsWorkers};
+	IslandSolver islandSolver{physicsWorkers};
 	Spider spider;
 
 	// Two part path
@@ -210,8 +227,17 @@ public:
 
 	/**
 	 * Initialize objects with physics interactions here.
-	 * There are two types of colliders: spheres and meshes.
-	 * Note that spheres can collide with meshes and other spheres, but meshes can't collide with other meshes.
+	 * The colliders are ColliderSphere, ColliderBox, ColliderCapsule, ColliderConvex, ColliderMesh, ColliderSDF
+	 * and ColliderHeightfield.
+	 * Everything collides with everything else except that meshes only collide with spheres and convex hulls,
+	 * so give a prop that has to rest on other props a ColliderConvex of its mesh.
+	 * A big static mesh that only spheres touch can be baked into a ColliderSDF instead, which is much
+	 * cheaper to test against. Pass it physicsWorkers and a cache file to keep the bake off later loads.
+	 * Ground that is one height at each point is cheapest as a ColliderHeightfield, which can be sampled from
+	 * its mesh. Both of these only collide with spheres.
+	 * Scenes can swap out the broadphase. The default AABBTree handles mixed sizes. Use
+	 * make_shared<SpatialHash>(cellSize) for big groups of similarly sized spheres, where cellSize is about
+	 * the diameter of one sphere, or make_shared<SweepAndPrune>() for scenes that barely move.
 	 */
 	void initPhysicsObjects() {
 		PhysicsObject::setCulling(false);
@@ -227,8 +253,7 @@ public:
 		physicsBall->setFriction(0.25);
 		physicsObjects.push_back(physicsBall);
 
-		cube->findEdges(); // need to call this for shapes used as collision meshes
-		auto physicsCube = make_shared<PhysicsObject>(vec3(2, -4, -10), cube, make_shared<ColliderMesh>(cube));
+		auto physicsCube = make_shared<PhysicsObject>(vec3(2, -4, -10), cube, make_shared<ColliderBox>(cube->size / 2.0f));
 		physicsCube->setElasticity(0.5);
 		physicsCube->setFriction(0.25);
 		physicsCube->orientation = rotate(quat(1, 0, 0, 0), 45.0f, vec3(0, 1, 0));
@@ -340,7 +365,7 @@ public:
 
         simple->bind();
             // Apply perspective projection.
-            SetProjectionMatrix(simple);
+            mat4 Projection = SetProjectionMatrix(simple);
             SetViewMatrix(simple);
 
 			// Demo of Bezier Spline
@@ -375,28 +400,56 @@ public:
                 spider.draw(simple, Model);
             Model->popMatrix();
 
+			cullPhysicsObjects(Projection * lookAt(camera.eye, camera.target, camera.up));
 			for (auto obj : physicsObjects) {
-				obj->draw(simple, Model);
+				drawObject(simple, Model, obj.get());
 			}
         simple->unbind();
     }
 
-	void updatePhysics(float dt) {
-		for (int i = 0; i < physicsObjects.size(); i++) {
-			for (int j = i + 1; j < physicsObjects.size(); j++) {
-				physicsObjects[i]->checkCollision(physicsObjects[j].get());
-			}
+	// Sets inView on the physics objects from the bounds they are drawn at, which are between their last two
+	// steps, so it can't use the broadphase's bounds
+	void cullPhysicsObjects(const mat4 &PV) {
+		if (!GameObject::cull) {
+			return;
 		}
+
+		// frustum planes from the rows of the view projection matrix (Gribb & Hartmann)
+		mat4 rows = transpose(PV);
+		vec4 planes[6] = {
+			rows[3] + rows[0], rows[3] - rows[0],
+			rows[3] + rows[1], rows[3] - rows[1],
+			rows[3] + rows[2], rows[3] - rows[2]
+		};
+
 		for (auto obj : physicsObjects) {
-			obj->update();
+			vec3 min, max;
+			obj->getRenderBounds(min, max);
+			obj->inView = true;
+			for (int i = 0; i < 6 && obj->inView; i++) {
+				// corner furthest along the plane normal
+				vec3 n = vec3(planes[i]);
+				vec3 p = vec3(n.x >= 0 ? max.x : min.x, n.y >= 0 ? max.y : min.y, n.z >= 0 ? max.z : min.z);
+				obj->inView = dot(n, p) + planes[i].w >= 0;
+			}
 		}
 	}
 
+	void updatePhysics(float dt) {
+		World.beginStep(dt);
+		broadphase->findPairs(physicsObjects, broadphasePairs);
+		narrowPhase.run(physicsObjects, broadphasePairs);
+		World.applyGravity();
+		islandSolver.update(physicsObjects);
+		World.integrate(*broadphase);
+	}
+
 	vec3 milesPosition;
 	void setupMilesScene() {
 		// put models in their starting positions.
 		// variables can be declared in global scope for use in the render function, and initialized here.
 		// if you want to use physics, call physicsObjects.clear() then add your own physics objects.
+		// set broadphase to change how the scene finds colliding pairs (see initPhysicsObjects).
 		milesPosition = vec3(0);
 	}
 
@@ -489,7 +542,7 @@ public:
             Model->popMatrix();
 
 			/*for (auto obj : physicsObjects) {
-				obj->draw(simple, Model);
+				drawObject(simple, Model, obj.get());
 			}*/
         simple->unbind();
 	}
@@ -556,11 +609,19 @@ int main(int argc, char *argv[])
 		lastTime = nextLastTime;
 
 		accumulator += deltaTime;
-		while (accumulator >= Time.physicsDeltaTime) {
+		int steps = 0;
+		while (accumulator >= Time.physicsDeltaTime && steps < MAX_PHYSICS_STEPS) {
 			application->updatePhysics(Time.physicsDeltaTime);
 			accumulator -= Time.physicsDeltaTime;
+			steps++;
+		}
+		if (accumulator >= Time.physicsDeltaTime) {
+			accumulator = fmod(accumulator, Time.physicsDeltaTime);
 		}
 
+		// physics objects are drawn this far between their last two steps
+		World.renderAlpha = accumulator / Time.physicsDeltaTime;
+
 		// Render scene.
 		application->render(deltaTime);
 
@@ -0,0 +1,352 @@
+#include "AABBTree.h"
+
+AABBTree::AABBTree(float margin) :
+    margin(margin), root(-1), freeList(-1)
+{
+}
+
+void AABBTree::findOverlaps(const vector<shared_ptr<PhysicsObject>> &objects, vector<BroadphasePair> &pairs)
+{
+    update(objects);
+
+    pairs.clear();
+    for (int i = 0; i < (int)objects.size(); i++)
+    {
+        if (!moving[i])
+        {
+            continue;
+        }
+        queryLeaves(mins[i], maxs[i], [&](const Node &leaf)
+        {
+            int j = leaf.index;
+            if (reportsPair(i, j) && overlaps(mins[i], maxs[i], mins[j], maxs[j]))
+            {
+                pairs.push_back(makePair(i, j));
+            }
+            return true;
+        });
+    }
+    sort(pairs.begin(), pairs.end());
+}
+
+void AABBTree::update(const vector<shared_ptr<PhysicsObject>> &objects)
+{
+    bool changed = sync(objects);
+
+    // only reinsert objects that left their fat box. Sleeping objects haven't
+    // moved, so they keep their bounds unless the list changed under them.
+    for (size_t i = 0; i < objects.size(); i++)
+    {
+        if (!changed && World.isAsleep(objects[i]->getBody()))
+        {
+            continue;
+        }
+        objects[i]->getBounds(mins[i], maxs[i]);
+        Node &leaf = nodes[leaves[i]];
+        if (mins[i].x < leaf.min.x || mins[i].y < leaf.min.y || mins[i].z < leaf.min.z ||
+            maxs[i].x > leaf.max.x || maxs[i].y > leaf.max.y || maxs[i].z > leaf.max.z)
+        {
+            removeLeaf(leaves[i]);
+            nodes[leaves[i]].min = mins[i] - margin;
+            nodes[leaves[i]].max = maxs[i] + margin;
+            insertLeaf(leaves[i]);
+        }
+    }
+}
+
+void AABBTree::query(const vec3 &min, const vec3 &max, vector<PhysicsObject *> &found) const
+{
+    queryLeaves(min, max, [&](const Node &leaf)
+    {
+        found.push_back(leaf.object);
+        return true;
+    });
+}
+
+int AABBTree::getHeight() const
+{
+    return root == -1 ? 0 : nodes[root].height;
+}
+
+// Makes a leaf for every object in the list and removes leaves of objects that
+// are gone. Returns whether the list changed.
+bool AABBTree::sync(const vector<shared_ptr<PhysicsObject>> &objects)
+{
+    if (sameObjects(objects))
+    {
+        return false;
+    }
+
+    unordered_map<PhysicsObject *, int> current;
+    for (size_t i = 0; i < objects.size(); i++)
+    {
+        current[objects[i].get()] = (int)i;
+    }
+    for (auto it = proxies.begin(); it != proxies.end();)
+    {
+        if (current.find(it->first) == current.end())
+        {
+            removeLeaf(it->second);
+            freeNode(it->second);
+            it = proxies.erase(it);
+        }
+        else
+        {
+            ++it;
+        }
+    }
+
+    leaves.resize(objects.size());
+    mins.resize(objects.size());
+    maxs.resize(objects.size());
+    for (size_t i = 0; i < objects.size(); i++)
+    {
+        PhysicsObject *object = objects[i].get();
+        auto proxy = proxies.find(object);
+        int leaf;
+        if (proxy == proxies.end())
+        {
+            leaf = allocateNode();
+            nodes[leaf].object = object;
+            object->getBounds(nodes[leaf].min, nodes[leaf].max);
+            nodes[leaf].min -= margin;
+            nodes[leaf].max += margin;
+            insertLeaf(leaf);
+            proxies[object] = leaf;
+        }
+        else
+        {
+            leaf = proxy->second;
+        }
+        nodes[leaf].index = (int)i;
+        leaves[i] = leaf;
+    }
+    return true;
+}
+
+int AABBTree::allocateNode()
+{
+    if (freeList == -1)
+    {
+        Node node;
+        node.parent = -1;
+        nodes.push_back(node);
+        freeList = (int)nodes.size() - 1;
+    }
+
+    int node = freeList;
+    freeList = nodes[node].parent;
+    nodes[node].parent = -1;
+    nodes[node].child1 = -1;
+    nodes[node].child2 = -1;
+    nodes[node].height = 0;
+    nodes[node].object = NULL;
+    nodes[node].index = -1;
+    return node;
+}
+
+void AABBTree::freeNode(int node)
+{
+    nodes[node].parent = freeList;
+    nodes[node].height = -1;
+    freeList = node;
+}
+
+float AABBTree::area(const vec3 &min, const vec3 &max)
+{
+    vec3 d = max - min;
+    return 2.0f * (d.x * d.y + d.y * d.z + d.z * d.x);
+}
+
+void AABBTree::insertLeaf(int leaf)
+{
+    if (root == -1)
+    {
+        root = leaf;
+        nodes[root].parent = -1;
+        return;
+    }
+
+    // find the best sibling using the surface area heuristic
+    vec3 leafMin = nodes[leaf].min;
+    vec3 leafMax = nodes[leaf].max;
+    int index = root;
+    while (!nodes[index].isLeaf())
+    {
+        const Node &node = nodes[index];
+        float nodeArea = area(node.min, node.max);
+        float combinedArea = area(glm::min(node.min, leafMin), glm::max(node.max, leafMax));
+
+        // cost of making a new parent for this node and the leaf
+        float cost = 2.0f * combinedArea;
+        // minimum cost of pushing the leaf further down the tree
+        float inheritanceCost = 2.0f * (combinedArea - nodeArea);
+
+        float childCost[2];
+        int children[2] = {node.child1, node.child2};
+        for (int i = 0; i < 2; i++)
+        {
+            const Node &child = nodes[children[i]];
+            float newArea = area(glm::min(child.min, leafMin), glm::max(child.max, leafMax));
+            if (child.isLeaf())
+            {
+                childCost[i] = newArea + inheritanceCost;
+            }
+            else
+            {
+                childCost[i] = newArea - area(child.min, child.max) + inheritanceCost;
+            }
+        }
+
+        if (cost < childCost[0] && cost < childCost[1])
+        {
+            break;
+        }
+        index = childCost[0] < childCost[1] ? children[0] : children[1];
+    }
+    int sibling = index;
+
+    int oldParent = nodes[sibling].parent;
+    int newParent = allocateNode();
+    nodes[newParent].parent = oldParent;
+    nodes[newParent].min = glm::min(leafMin, nodes[sibling].min);
+    nodes[newParent].max = glm::max(leafMax, nodes[sibling].max);
+    nodes[newParent].height = nodes[sibling].height + 1;
+    nodes[newParent].child1 = sibling;
+    nodes[newParent].child2 = leaf;
+    nodes[sibling].parent = newParent;
+    nodes[leaf].parent = newParent;
+
+    if (oldParent != -1)
+    {
+        if (nodes[oldParent].child1 == sibling)
+        {
+            nodes[oldParent].child1 = newParent;
+        }
+        else
+        {
+            nodes[oldParent].child2 = newParent;
+        }
+    }
+    else
+    {
+        root = newParent;
+    }
+
+    refit(nodes[leaf].parent);
+}
+
+void AABBTree::removeLeaf(int leaf)
+{
+    if (leaf == root)
+    {
+        root = -1;
+        return;
+    }
+
+    int parent = nodes[leaf].parent;
+    int grandParent = nodes[parent].parent;
+    int sibling = nodes[parent].child1 == leaf ? nodes[parent].child2 : nodes[parent].child1;
+
+    if (grandParent != -1)
+    {
+        if (nodes[grandParent].child1 == parent)
+        {
+            nodes[grandParent].child1 = sibling;
+        }
+        else
+        {
+            nodes[grandParent].child2 = sibling;
+        }
+        nodes[sibling].parent = grandParent;
+        freeNode(parent);
+        refit(grandParent);
+    }
+    else
+    {
+        root = sibling;
+        nodes[sibling].parent = -1;
+        freeNode(parent);
+    }
+    nodes[leaf].parent = -1;
+}
+
+// Walks up from node, rebalancing and fixing heights and boxes
+void AABBTree::refit(int node)
+{
+    while (node != -1)
+    {
+        node = balance(node);
+
+        Node &n = nodes[node];
+        const Node &child1 = nodes[n.child1];
+        const Node &child2 = nodes[n.child2];
+        n.height = 1 + (std::max)(child1.height, child2.height);
+        n.min = glm::min(child1.min, child2.min);
+        n.max = glm::max(child1.max, child2.max);
+
+        node = n.parent;
+    }
+}
+
+// If a is out of balance, rotate its taller child up. Returns the new root of the subtree.
+int AABBTree::balance(int a)
+{
+    Node &A = nodes[a];
+    if (A.isLeaf() || A.height < 2)
+    {
+        return a;
+    }
+
+    int b = A.child1;
+    int c = A.child2;
+    int diff = nodes[c].height - nodes[b].height;
+    if (diff >= -1 && diff <= 1)
+    {
+        return a;
+    }
+
+    // rotate the taller child (up) above a
+    int up = diff > 1 ? c : b;
+    int other = diff > 1 ? b : c;
+    Node &U = nodes[up];
+    int f = U.child1;
+    int g = U.child2;
+
+    U.child1 = a;
+    U.parent = A.parent;
+    A.parent = up;
+
+    if (U.parent != -1)
+    {
+        if (nodes[U.parent].child1 == a)
+        {
+            nodes[U.parent].child1 = up;
+        }
+        else
+        {
+            nodes[U.parent].child2 = up;
+        }
+    }
+    else
+    {
+        root = up;
+    }
+
+    // keep the taller grandchild under up, give the other one to a
+    int keep = nodes[f].height > nodes[g].height ? f : g;
+    int give = keep == f ? g : f;
+    U.child2 = keep;
+    A.child1 = other;
+    A.child2 = give;
+    nodes[give].parent = a;
+
+    A.min = glm::min(nodes[other].min, nodes[give].min);
+    A.max = glm::max(nodes[other].max, nodes[give].max);
+    A.height = 1 + (std::max)(nodes[other].height, nodes[give].height);
+    U.min = glm::min(A.min, nodes[keep].min);
+    U.max = glm::max(A.max, nodes[keep].max);
+    U.height = 1 + (std::max)(A.height, nodes[keep].height);
+
+    return up;
+}
@@ -0,0 +1,196 @@
+#pragma once
+
+#include <unordered_map>
+
+#include "Broadphase.h"
+
+// https://box2d.org/files/ErinCatto_DynamicBVH_GDC2019.pdf
+// Bounding volume tree over each object's collider bounding box, for scenes
+// mixing big meshes with lots of small spheres. Leaves store a fattened box
+// so an object is only reinserted once it leaves it. The tree can also be
+// queried directly with boxes, rays or a view frustum.
+class AABBTree : public Broadphase
+{
+public:
+    AABBTree(float margin = 0.1f);
+
+    // Brings the tree up to date with the objects without looking for pairs.
+    // Call this before querying if the objects may have changed since findPairs.
+    void update(const vector<shared_ptr<PhysicsObject>> &objects);
+
+    // Adds every object whose fat box overlaps the box to found
+    virtual void query(const vec3 &min, const vec3 &max, vector<PhysicsObject *> &found) const;
+
+    // Calls callback(PhysicsObject *) for every object whose fat box overlaps the query.
+    // Returning false from the callback stops the query.
+    template <typename T> void query(const vec3 &min, const vec3 &max, T callback) const;
+    template <typename T> void raycast(const vec3 &origin, const vec3 &dir, float maxDistance, T callback) const;
+    // planes are (normal, d) pointing into the frustum
+    template <typename T> void queryFrustum(const vec4 planes[6], T callback) const;
+
+    int getHeight() const;
+
+    float margin; // how far boxes are fattened on each side
+
+protected:
+    virtual void findOverlaps(const vector<shared_ptr<PhysicsObject>> &objects, vector<BroadphasePair> &pairs);
+
+private:
+    struct Node
+    {
+        vec3 min;
+        vec3 max;
+        int parent; // next free node when not in use
+        int child1;
+        int child2;
+        int height; // 0 for leaves, -1 when free
+        PhysicsObject *object;
+        int index; // into the object list given to findPairs
+
+        bool isLeaf() const
+        {
+            return child1 == -1;
+        }
+    };
+
+    template <typename T> void queryLeaves(const vec3 &min, const vec3 &max, T callback) const;
+    int allocateNode();
+    void freeNode(int node);
+    void insertLeaf(int leaf);
+    void removeLeaf(int leaf);
+    void refit(int node);
+    int balance(int a);
+    bool sync(const vector<shared_ptr<PhysicsObject>> &objects);
+
+    static float area(const vec3 &min, const vec3 &max);
+
+    vector<Node> nodes;
+    int root;
+    int freeList;
+
+    unordered_map<PhysicsObject *, int> proxies;
+    vector<int> leaves; // leaf for each object in the current object list
+    mutable vector<int> stack;
+};
+
+template <typename T>
+void AABBTree::query(const vec3 &min, const vec3 &max, T callback) const
+{
+    queryLeaves(min, max, [&](const Node &leaf)
+    {
+        return callback(leaf.object);
+    });
+}
+
+template <typename T>
+void AABBTree::queryLeaves(const vec3 &min, const vec3 &max, T callback) const
+{
+    if (root == -1) return;
+
+    stack.clear();
+    stack.push_back(root);
+    while (!stack.empty())
+    {
+        const Node &node = nodes[stack.back()];
+        stack.pop_back();
+        if (!overlaps(node.min, node.max, min, max))
+        {
+            continue;
+        }
+        if (node.isLeaf())
+        {
+            if (!callback(node)) return;
+        }
+        else
+        {
+            stack.push_back(node.child1);
+            stack.push_back(node.child2);
+        }
+    }
+}
+
+template <typename T>
+void AABBTree::raycast(const vec3 &origin, const vec3 &dir, float maxDistance, T callback) const
+{
+    if (root == -1) return;
+
+    vec3 invDir = 1.0f / dir;
+    stack.clear();
+    stack.push_back(root);
+    while (!stack.empty())
+    {
+        const Node &node = nodes[stack.back()];
+        stack.pop_back();
+
+        // slab test. A ray parallel to a slab is inside it everywhere or nowhere,
+        // and dividing by its 0 would give 0 * inf = NaN on the slab's planes.
+        float enter = 0;
+        float exit = maxDistance;
+        for (int k = 0; k < 3 && enter <= exit; k++)
+        {
+            if (dir[k] == 0)
+            {
+                if (origin[k] < node.min[k] || origin[k] > node.max[k])
+                {
+                    exit = -1;
+                }
+                continue;
+            }
+            float t0 = (node.min[k] - origin[k]) * invDir[k];
+            float t1 = (node.max[k] - origin[k]) * invDir[k];
+            enter = (std::max)(enter, (std::min)(t0, t1));
+            exit = (std::min)(exit, (std::max)(t0, t1));
+        }
+        if (enter > exit)
+        {
+            continue;
+        }
+        if (node.isLeaf())
+        {
+            if (!callback(node.object)) return;
+        }
+        else
+        {
+            stack.push_back(node.child1);
+            stack.push_back(node.child2);
+        }
+    }
+}
+
+template <typename T>
+void AABBTree::queryFrustum(const vec4 planes[6], T callback) const
+{
+    if (root == -1) return;
+
+    stack.clear();
+    stack.push_back(root);
+    while (!stack.empty())
+    {
+        const Node &node = nodes[stack.back()];
+        stack.pop_back();
+
+        bool outside = false;
+        for (int i = 0; i < 6 && !outside; i++)
+        {
+            // corner furthest along the plane normal
+            vec3 n = vec3(planes[i]);
+            vec3 p = vec3(n.x >= 0 ? node.max.x : node.min.x,
+                n.y >= 0 ? node.max.y : node.min.y,
+                n.z >= 0 ? node.max.z : node.min.z);
+            outside = dot(n, p) + planes[i].w < 0;
+        }
+        if (outside)
+        {
+            continue;
+        }
+        if (node.isLeaf())
+        {
+            if (!callback(node.object)) return;
+        }
+        else
+        {
+            stack.push_back(node.child1);
+            stack.push_back(node.child2);
+        }
+    }
+}
@@ -0,0 +1,78 @@
+#include "Broadphase.h"
+
+void Broadphase::findPairs(const vector<shared_ptr<PhysicsObject>> &objects, vector<BroadphasePair> &pairs)
+{
+    moving.resize(objects.size());
+    for (size_t i = 0; i < objects.size(); i++)
+    {
+        moving[i] = World.isMoving(objects[i]->getBody());
+    }
+    findOverlaps(objects, pairs);
+}
+
+void Broadphase::query(const vec3 &min, const vec3 &max, vector<PhysicsObject *> &found) const
+{
+    for (size_t i = 0; i < objectList.size(); i++)
+    {
+        if (overlaps(mins[i], maxs[i], min, max))
+        {
+            found.push_back(objectList[i]);
+        }
+    }
+}
+
+bool Broadphase::sameObjects(const vector<shared_ptr<PhysicsObject>> &objects)
+{
+    bool same = objects.size() == objectList.size();
+    for (size_t i = 0; i < objects.size() && same; i++)
+    {
+        same = objects[i].get() == objectList[i];
+    }
+    if (!same)
+    {
+        objectList.resize(objects.size());
+        for (size_t i = 0; i < objects.size(); i++)
+        {
+            objectList[i] = objects[i].get();
+        }
+    }
+    return same;
+}
+
+void Broadphase::computeBounds(const vector<shared_ptr<PhysicsObject>> &objects, bool keepAsleep)
+{
+    mins.resize(objects.size());
+    maxs.resize(objects.size());
+    for (size_t i = 0; i < objects.size(); i++)
+    {
+        if (keepAsleep && World.isAsleep(objects[i]->getBody()))
+        {
+            continue;
+        }
+        vec3 center = objects[i]->getCenterPos();
+        float radius = objects[i]->getRadius();
+        mins[i] = center - radius;
+        maxs[i] = center + radius;
+    }
+}
+
+void AllPairs::findOverlaps(const vector<shared_ptr<PhysicsObject>> &objects, vector<BroadphasePair> &pairs)
+{
+    // only needed for queries
+    computeBounds(objects, sameObjects(objects));
+
+    pairs.clear();
+    for (int i = 0; i < (int)objects.size(); i++)
+    {
+        for (int j = i + 1; j < (int)objects.size(); j++)
+        {
+            if (moving[i] || moving[j])
+            {
+                BroadphasePair pair;
+                pair.a = i;
+                pair.b = j;
+                pairs.push_back(pair);
+            }
+        }
+    }
+}
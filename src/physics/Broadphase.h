@@ -0,0 +1,85 @@
+#pragma once
+
+#include <memory>
+#include <vector>
+#include <cstdint>
+
+#include "PhysicsObject.h"
+
+using namespace std;
+
+// A pair of indices into the object list passed to findPairs, with a < b
+struct BroadphasePair
+{
+    int a, b;
+
+    bool operator<(const BroadphasePair &p) const
+    {
+        return a < p.a || (a == p.a && b < p.b);
+    }
+};
+
+inline uint64_t pairKey(int a, int b)
+{
+    return ((uint64_t)(std::min)(a, b) << 32) | (uint32_t)(std::max)(a, b);
+}
+
+// Finds pairs of objects whose bounds overlap so that only those pairs
+// have to go through the (much more expensive) collider tests.
+class Broadphase
+{
+public:
+    virtual ~Broadphase() {}
+
+    // Fills pairs with every potentially colliding pair, sorted by (a, b).
+    // Pairs where neither object can move (asleep or no mass) are left out.
+    void findPairs(const vector<shared_ptr<PhysicsObject>> &objects, vector<BroadphasePair> &pairs);
+
+    // Adds every object whose bounds from the last findPairs overlap the box to
+    // found. Can also give objects that don't overlap it.
+    virtual void query(const vec3 &min, const vec3 &max, vector<PhysicsObject *> &found) const;
+
+protected:
+    // Fills pairs with every pair whose bounds overlap and where at least one
+    // object is moving, sorted by (a, b). Only moving objects need to look for
+    // overlaps, the rest are only there to be found.
+    virtual void findOverlaps(const vector<shared_ptr<PhysicsObject>> &objects, vector<BroadphasePair> &pairs) = 0;
+
+    // Whether objects is the same list as last time, then remembers it in objectList
+    bool sameObjects(const vector<shared_ptr<PhysicsObject>> &objects);
+    // Sets mins and maxs to the world space bounds of each object's bounding
+    // sphere. With keepAsleep, the bounds are from the same list of objects and
+    // bodies that are asleep keep theirs, since they can't have moved.
+    void computeBounds(const vector<shared_ptr<PhysicsObject>> &objects, bool keepAsleep = false);
+    static bool overlaps(const vec3 &min0, const vec3 &max0, const vec3 &min1, const vec3 &max1)
+    {
+        return min0.x <= max1.x && min1.x <= max0.x &&
+            min0.y <= max1.y && min1.y <= max0.y &&
+            min0.z <= max1.z && min1.z <= max0.z;
+    }
+    // Whether a pair between moving object i and object j should be reported
+    // from i, so that a pair of moving objects is only reported once
+    bool reportsPair(int i, int j) const
+    {
+        return j != i && (!moving[j] || j > i);
+    }
+    static BroadphasePair makePair(int i, int j)
+    {
+        BroadphasePair pair;
+        pair.a = (std::min)(i, j);
+        pair.b = (std::max)(i, j);
+        return pair;
+    }
+
+    vector<char> moving; // for each object, set by findPairs before findOverlaps
+    vector<PhysicsObject *> objectList; // objects from the last findPairs
+    vector<vec3> mins; // bounds of each object, filled by findOverlaps
+    vector<vec3> maxs;
+};
+
+// Tests every pair of objects. Fine for a handful of objects.
+class AllPairs : public Broadphase
+{
+protected:
+    virtual void findOverlaps(const vector<shared_ptr<PhysicsObject>> &objects, vector<BroadphasePair> &pairs);
+};
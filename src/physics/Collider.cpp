@@ -2,24 +2,27 @@
 
 #include "ColliderSphere.h"
 #include "ColliderMesh.h"
+#include "ColliderBox.h"
+#include "ColliderCapsule.h"
+#include "ColliderConvex.h"
+#include "ColliderSDF.h"
+#include "ColliderHeightfield.h"
+#include "GJK.h"
+#include "ContactPool.h"
 #include "PhysicsObject.h"
-#include "../MatrixStack.h"
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/quaternion.hpp>
 
-Collider::Collider(vec3 min, vec3 max) :
-    bbox(min, max)
+Collider::Collider(ColliderType type, vec3 min, vec3 max) :
+    type(type), bbox(min, max)
 {
 }
 
-Collider::Collider(float radius) :
-    bbox(radius)
+Collider::Collider(ColliderType type, float radius) :
+    type(type), bbox(radius)
 {
 }
 
-void Collider::clearCollisions(PhysicsObject *owner)
-{
-    pendingCollisions.clear();
-}
-
 void checkSphereSphere(PhysicsObject *sphere1, ColliderSphere *sphereCol1, PhysicsObject *sphere2, ColliderSphere *sphereCol2)
 {
     float d = distance(sphere1->position, sphere2->position);
@@ -31,7 +34,7 @@ void checkSphereSphere(PhysicsObject *sphere1, ColliderSphere *sphereCol1, Physi
         collision1.penetration = sphere1->getRadius() + sphere2->getRadius() - d;
         collision1.geom = SPHERE;
         collision1.pos = sphere2->position + collision1.normal * sphere2->getRadius();
-        sphereCol1->pendingCollisions.push_back(collision1);
+        addCollision(sphere1, collision1);
 
         Collision collision2;
         collision2.other = sphere1;
@@ -39,107 +42,1526 @@ void checkSphereSphere(PhysicsObject *sphere1, ColliderSphere *sphereCol1, Physi
         collision2.penetration = collision1.penetration;
         collision2.geom = SPHERE;
         collision2.pos = collision1.pos;
-        sphereCol2->pendingCollisions.push_back(collision2);
+        addCollision(sphere2, collision2);
     }
 }
 
 
 
-void checkSphereMesh(PhysicsObject *sphere, ColliderSphere *sphereCol, PhysicsObject *mesh, ColliderMesh *meshCol)
+// http://realtimecollisiondetection.net/ (5.1.5)
+ColGeom closestPointOnTriangle(const vec3 &p, const vec3 &a, const vec3 &b, const vec3 &c, vec3 &closest, int &feature)
 {
+    vec3 ab = b - a;
+    vec3 ac = c - a;
+    vec3 ap = p - a;
+    float d1 = dot(ab, ap);
+    float d2 = dot(ac, ap);
+    if (d1 <= 0 && d2 <= 0)
+    {
+        closest = a;
+        feature = 0;
+        return VERT;
+    }
 
-    // Check bounding spheres
-    if (distance2(sphere->getCenterPos(), mesh->getCenterPos()) <= pow(sphere->getRadius() + mesh->getRadius(), 2))
+    vec3 bp = p - b;
+    float d3 = dot(ab, bp);
+    float d4 = dot(ac, bp);
+    if (d3 >= 0 && d4 <= d3)
     {
-        mat4 M = translate(mat4(1.f), mesh->position) * mat4_cast(mesh->orientation) * scale(mat4(1.f), mesh->scale);
+        closest = b;
+        feature = 1;
+        return VERT;
+    }
 
-        unordered_set<Edge, EdgeHash> edgeSet;
-        unordered_set<vec3> vertSet;
-        // Check faces
-        for (int i = 0; i < meshCol->mesh->getNumFaces(); i++)
-        {
-            vector<vec3> v = meshCol->mesh->getFace(i, M);
+    float vc = d1 * d4 - d3 * d2;
+    if (vc <= 0 && d1 >= 0 && d3 <= 0)
+    {
+        closest = a + ab * (d1 / (d1 - d3));
+        feature = 0;
+        return EDGE;
+    }
 
-            // Check if sphere is touching triangle
-            vec3 normal = normalize(cross(v[1] - v[0], v[2] - v[0]));
-            vec3 dir = -normal;
-            vec2 bary;
-            float d;
-            bool rayDidIntersect = intersectRayTriangle(sphere->position, dir, v[0], v[1], v[2], bary, d);
+    vec3 cp = p - c;
+    float d5 = dot(ab, cp);
+    float d6 = dot(ac, cp);
+    if (d6 >= 0 && d5 <= d6)
+    {
+        closest = c;
+        feature = 2;
+        return VERT;
+    }
+
+    float vb = d5 * d2 - d1 * d6;
+    if (vb <= 0 && d2 >= 0 && d6 <= 0)
+    {
+        closest = a + ac * (d2 / (d2 - d6));
+        feature = 2;
+        return EDGE;
+    }
+
+    float va = d3 * d6 - d5 * d4;
+    if (va <= 0 && d4 - d3 >= 0 && d5 - d6 >= 0)
+    {
+        closest = b + (c - b) * ((d4 - d3) / ((d4 - d3) + (d5 - d6)));
+        feature = 1;
+        return EDGE;
+    }
+
+    float denom = 1.0f / (va + vb + vc);
+    closest = a + ab * (vb * denom) + ac * (vc * denom);
+    feature = 0;
+    return FACE;
+}
+
+// An edge or vertex the sphere is touching, found from one of the triangles using it
+struct FeatureContact
+{
+    unsigned int id;
+    vec3 pos;
+    float d;
+
+    bool operator<(const FeatureContact &f) const
+    {
+        return id < f.id;
+    }
+};
+
+// A Shape's triangles the way collideSphereTriangles looks at them
+struct ShapeTriangles
+{
+    Shape *shape;
+
+    void getFace(int i, const mat4 &M, vec3 v[3]) const
+    {
+        shape->getFace(i, M, v);
+    }
+
+    unsigned int getFaceEdge(int i, int j) const
+    {
+        return shape->faceEdges[i * 3 + j];
+    }
+
+    unsigned int getFaceVertexId(int i, int j) const
+    {
+        return shape->getFaceVertexId(i, j);
+    }
+
+    void getEdgeVertexIds(unsigned int edge, unsigned int ids[2]) const
+    {
+        ids[0] = shape->edgeBuffer[edge * 2];
+        ids[1] = shape->edgeBuffer[edge * 2 + 1];
+    }
+};
+
+// Turns the triangles within a sphere's radius into contacts with the closest
+// feature of each one. Only the front of a face is solid. Triangles gives the
+// faces and the ids of their edges and vertices, like ShapeTriangles.
+template <class Triangles>
+static void collideSphereTriangles(PhysicsObject *sphere, PhysicsObject *mesh, const Triangles &triangles, const mat4 &M, const vector<int> &faces)
+{
+    // Scratch buffers, kept between calls so they don't have to be reallocated
+    static thread_local vector<FeatureContact> edgeContacts;
+    static thread_local vector<FeatureContact> vertContacts;
+    static thread_local vector<unsigned int> faceEdges; // edges of triangles the sphere is resting on
+    static thread_local vector<unsigned int> edgeVerts; // vertices of edges the sphere is resting on
+
+    float radius = sphere->getRadius();
+    edgeContacts.clear();
+    vertContacts.clear();
+    faceEdges.clear();
+    edgeVerts.clear();
+
+    // Find the closest feature of each triangle. Faces are reported right away,
+    // edges and vertices can be shared by several triangles so they are collected
+    // by index first.
+    for (int i : faces)
+    {
+        vec3 v[3];
+        triangles.getFace(i, M, v);
 
-            if (rayDidIntersect && d > 0 && d < sphere->getRadius())
+        vec3 closest;
+        int feature;
+        ColGeom geom = closestPointOnTriangle(sphere->position, v[0], v[1], v[2], closest, feature);
+        if (geom == FACE)
+        {
+            // only collide with the front of the face
+            vec3 normal = normalize(cross(v[1] - v[0], v[2] - v[0]));
+            float d = dot(sphere->position - v[0], normal);
+            if (d > 0 && d < radius)
             {
                 Collision collision;
                 collision.other = mesh;
-                collision.normal = dir;
-                collision.penetration = sphere->getRadius() - d;
+                collision.normal = -normal;
+                collision.penetration = radius - d;
                 collision.geom = FACE;
+                collision.feature = i;
                 collision.v[0] = v[0];
                 collision.v[1] = v[1];
                 collision.v[2] = v[2];
                 collision.pos = sphere->position + collision.normal * d;
-                sphereCol->pendingCollisions.push_back(collision);
+                addCollision(sphere, collision);
 
-                // add edges of triangle to set of edges we shouldn't check
-                edgeSet.insert(Edge(v[0], v[1]));
-                edgeSet.insert(Edge(v[1], v[2]));
-                edgeSet.insert(Edge(v[2], v[0]));
+                // the face covers its edges
+                for (int j = 0; j < 3; j++)
+                {
+                    faceEdges.push_back(triangles.getFaceEdge(i, j));
+                }
             }
+            continue;
+        }
+
+        float d = distance(sphere->position, closest);
+        if (d >= radius)
+        {
+            continue;
+        }
+
+        FeatureContact contact;
+        contact.pos = closest;
+        contact.d = d;
+        if (geom == EDGE)
+        {
+            contact.id = triangles.getFaceEdge(i, feature);
+            edgeContacts.push_back(contact);
+        }
+        else
+        {
+            contact.id = triangles.getFaceVertexId(i, feature);
+            vertContacts.push_back(contact);
+        }
+    }
+
+    // Edges not covered by a face the sphere is touching
+    sort(faceEdges.begin(), faceEdges.end());
+    sort(edgeContacts.begin(), edgeContacts.end());
+    for (size_t i = 0; i < edgeContacts.size(); i++)
+    {
+        const FeatureContact &edge = edgeContacts[i];
+        if ((i > 0 && edgeContacts[i - 1].id == edge.id) || binary_search(faceEdges.begin(), faceEdges.end(), edge.id))
+        {
+            continue;
+        }
+
+        Collision collision;
+        collision.other = mesh;
+        collision.normal = normalize(edge.pos - sphere->position);
+        collision.penetration = radius - edge.d;
+        collision.geom = EDGE;
+        collision.feature = edge.id;
+        collision.pos = edge.pos;
+        addCollision(sphere, collision);
+
+        // the edge covers its vertices
+        unsigned int ids[2];
+        triangles.getEdgeVertexIds(edge.id, ids);
+        edgeVerts.push_back(ids[0]);
+        edgeVerts.push_back(ids[1]);
+    }
+
+    // Vertices not covered by an edge the sphere is touching
+    sort(edgeVerts.begin(), edgeVerts.end());
+    sort(vertContacts.begin(), vertContacts.end());
+    for (size_t i = 0; i < vertContacts.size(); i++)
+    {
+        const FeatureContact &vert = vertContacts[i];
+        if ((i > 0 && vertContacts[i - 1].id == vert.id) || binary_search(edgeVerts.begin(), edgeVerts.end(), vert.id))
+        {
+            continue;
+        }
+
+        Collision collision;
+        collision.other = mesh;
+        collision.normal = normalize(vert.pos - sphere->position);
+        collision.penetration = radius - vert.d;
+        collision.geom = VERT;
+        collision.feature = vert.id;
+        collision.pos = vert.pos;
+        addCollision(sphere, collision);
+    }
+}
+
+void checkSphereMesh(PhysicsObject *sphere, ColliderSphere *sphereCol, PhysicsObject *mesh, ColliderMesh *meshCol)
+{
+    // Scratch buffers, kept between calls so they don't have to be reallocated
+    static thread_local vector<int> ranges;
+    static thread_local vector<int> faces;
+
+    // Check bounding spheres
+    if (distance2(sphere->getCenterPos(), mesh->getCenterPos()) <= pow(sphere->getRadius() + mesh->getRadius(), 2))
+    {
+        mat4 M = translate(mat4(1.f), mesh->position) * mat4_cast(mesh->orientation) * scale(mat4(1.f), mesh->scale);
+        Shape *shape = meshCol->mesh.get();
+        float radius = sphere->getRadius();
+
+        // Find the triangles near the sphere using the sphere's bounds in mesh space
+        vec3 localCenter = (inverse(mesh->orientation) * (sphere->position - mesh->position)) / mesh->scale;
+        vec3 localExtent = radius / abs(mesh->scale);
+        ranges.clear();
+        shape->bvh.queryLeaves(localCenter - localExtent, localCenter + localExtent, ranges);
+
+        // Test each leaf's triangles a packet at a time. This only finds the triangles
+        // within the radius, which ones are faces, edges or vertices is decided below.
+        faces.clear();
+        for (size_t i = 0; i < ranges.size(); i += 2)
+        {
+            size_t first = faces.size();
+            faces.resize(first + ranges[i + 1]);
+            int hits = findSphereTriangles(meshCol->triangles, ranges[i], ranges[i + 1], M, sphere->position, radius, &faces[first]);
+            faces.resize(first + hits);
+        }
+        for (int &i : faces)
+        {
+            i = shape->bvh.getFace(i);
+        }
+        if (faces.empty())
+        {
+            return;
+        }
+
+        ShapeTriangles triangles = {shape};
+        collideSphereTriangles(sphere, mesh, triangles, M, faces);
+    }
+}
+
+// Spheres are swept a little smaller than they are so that they end up slightly
+// inside what they hit, where the next step's collision test will find it.
+#define SWEEP_SKIN 0.05f
+
+// First time in [0, 1] that a sphere of radius r moving from s by m touches a point p.
+// Returns false if it doesn't, or if it's already touching at the start.
+static bool sweepSpherePoint(const vec3 &s, const vec3 &m, float r, const vec3 &p, float &t)
+{
+    vec3 w = s - p;
+    float a = dot(m, m);
+    float b = dot(m, w);
+    float c = dot(w, w) - r * r;
+    float disc = b * b - a * c;
+    if (c <= 0 || a == 0 || b >= 0 || disc < 0)
+    {
+        return false;
+    }
+    t = (-b - sqrt(disc)) / a;
+    return t <= 1;
+}
+
+// Same against the segment p0 p1, not counting its ends
+static bool sweepSphereSegment(const vec3 &s, const vec3 &m, float r, const vec3 &p0, const vec3 &p1, float &t)
+{
+    // work with the parts of the move and offset that are perpendicular to the segment
+    vec3 d = p1 - p0;
+    vec3 w = s - p0;
+    float dd = dot(d, d);
+    float md = dot(m, d);
+    float wd = dot(w, d);
+    float a = dd * dot(m, m) - md * md;
+    float b = dd * dot(m, w) - md * wd;
+    float c = dd * (dot(w, w) - r * r) - wd * wd;
+    float disc = b * b - a * c;
+    if (c <= 0 || a <= 0 || b >= 0 || disc < 0)
+    {
+        return false;
+    }
+    t = (-b - sqrt(disc)) / a;
+    float along = wd + md * t;
+    return t <= 1 && along >= 0 && along <= dd;
+}
+
+// Same against triangle abc. Only the front of the face is solid, like in checkSphereMesh.
+static bool sweepSphereTriangle(const vec3 &s, const vec3 &m, float r, const vec3 &a, const vec3 &b, const vec3 &c, float &t)
+{
+    vec3 normal = normalize(cross(b - a, c - a));
+    float d0 = dot(s - a, normal);
+    float d1 = dot(s + m - a, normal);
+    if (d0 >= r && d1 < r)
+    {
+        // where the sphere meets the plane, if that's inside the triangle nothing else is hit first
+        float tPlane = (d0 - r) / (d0 - d1);
+        vec3 p = s + m * tPlane - normal * r;
+        if (dot(cross(b - a, p - a), normal) >= 0 &&
+            dot(cross(c - b, p - b), normal) >= 0 &&
+            dot(cross(a - c, p - c), normal) >= 0)
+        {
+            t = tPlane;
+            return true;
+        }
+    }
+    else if (d0 <= -r && d1 <= -r)
+    {
+        // never reaches the plane
+        return false;
+    }
+
+    bool hit = false;
+    float tFeature;
+    const vec3 *v[3] = {&a, &b, &c};
+    t = 1;
+    for (int j = 0; j < 3; j++)
+    {
+        if (sweepSphereSegment(s, m, r, *v[j], *v[(j + 1) % 3], tFeature) && tFeature < t)
+        {
+            t = tFeature;
+            hit = true;
+        }
+        if (sweepSpherePoint(s, m, r, *v[j], tFeature) && tFeature < t)
+        {
+            t = tFeature;
+            hit = true;
+        }
+    }
+    return hit;
+}
+
+// First time a sphere moving from s by m touches any of the faces
+template <class Triangles>
+static float sweepSphereTriangles(const vec3 &s, const vec3 &m, float r, const Triangles &triangles, const mat4 &M, const vector<int> &faces)
+{
+    float first = 1;
+    for (int i : faces)
+    {
+        vec3 v[3];
+        triangles.getFace(i, M, v);
+        float t;
+        if (sweepSphereTriangle(s, m, r, v[0], v[1], v[2], t) && t < first)
+        {
+            first = t;
         }
+    }
+    return first;
+}
+
+float sweepSphereMesh(PhysicsObject *sphere, ColliderSphere *sphereCol, vec3 start, PhysicsObject *mesh, ColliderMesh *meshCol)
+{
+    static thread_local vector<int> faces;
 
-        // Check edges
-        for (int i = 0; i < meshCol->mesh->getNumEdges(); i++)
+    float radius = sphere->getRadius();
+    vec3 move = sphere->position - start;
+
+    // Check the swept sphere's bounding sphere
+    vec3 center = start + move * 0.5f;
+    float sweptRadius = radius + length(move) * 0.5f;
+    if (distance2(center, mesh->getCenterPos()) > pow(sweptRadius + mesh->getRadius(), 2))
+    {
+        return 1;
+    }
+
+    // Triangles near the move, using its bounds in mesh space
+    Shape *shape = meshCol->mesh.get();
+    quat invOrientation = inverse(mesh->orientation);
+    vec3 localStart = (invOrientation * (start - mesh->position)) / mesh->scale;
+    vec3 localEnd = (invOrientation * (sphere->position - mesh->position)) / mesh->scale;
+    vec3 localExtent = radius / abs(mesh->scale);
+    faces.clear();
+    shape->bvh.query(min(localStart, localEnd) - localExtent, max(localStart, localEnd) + localExtent, faces);
+
+    mat4 M = translate(mat4(1.f), mesh->position) * mat4_cast(mesh->orientation) * scale(mat4(1.f), mesh->scale);
+    ShapeTriangles triangles = {shape};
+    return sweepSphereTriangles(start, move, radius * (1 - SWEEP_SKIN), triangles, M, faces);
+}
+
+float sweepSphereSphere(PhysicsObject *sphere1, ColliderSphere *sphereCol1, vec3 start, PhysicsObject *sphere2, ColliderSphere *sphereCol2)
+{
+    float radius = (sphere1->getRadius() + sphere2->getRadius()) * (1 - SWEEP_SKIN);
+    float t;
+    if (sweepSpherePoint(start, sphere1->position - start, radius, sphere2->position, t))
+    {
+        return t;
+    }
+    return 1;
+}
+
+
+
+// Box and capsule tests. These are all closed form: the boxes are tested in the
+// space of one of the boxes, where they're axis aligned, and capsules are treated
+// as spheres at the closest points of their segments.
+
+// A ColliderBox in world space
+struct OrientedBox
+{
+    vec3 center;
+    vec3 axis[3];
+    vec3 halfSize;
+};
+
+static OrientedBox getOrientedBox(PhysicsObject *box, ColliderBox *boxCol)
+{
+    OrientedBox b;
+    mat3 R = mat3_cast(box->orientation);
+    b.center = box->position;
+    b.axis[0] = R[0];
+    b.axis[1] = R[1];
+    b.axis[2] = R[2];
+    b.halfSize = boxCol->halfSize * abs(box->scale);
+    return b;
+}
+
+static vec3 toBoxDirection(const OrientedBox &b, const vec3 &v)
+{
+    return vec3(dot(v, b.axis[0]), dot(v, b.axis[1]), dot(v, b.axis[2]));
+}
+
+static vec3 toBox(const OrientedBox &b, const vec3 &p)
+{
+    return toBoxDirection(b, p - b.center);
+}
+
+static vec3 fromBoxDirection(const OrientedBox &b, const vec3 &v)
+{
+    return b.axis[0] * v.x + b.axis[1] * v.y + b.axis[2] * v.z;
+}
+
+static vec3 fromBox(const OrientedBox &b, const vec3 &p)
+{
+    return b.center + fromBoxDirection(b, p);
+}
+
+// The corner of the box furthest along dir
+static vec3 boxSupport(const OrientedBox &b, const vec3 &dir)
+{
+    vec3 p = b.center;
+    for (int k = 0; k < 3; k++)
+    {
+        p += b.axis[k] * (dot(b.axis[k], dir) >= 0 ? b.halfSize[k] : -b.halfSize[k]);
+    }
+    return p;
+}
+
+// Edge i (0 to 11) of the box with half size h centered on the origin. Edges 4k to
+// 4k + 3 run along axis k.
+static void getBoxEdge(const vec3 &h, int i, vec3 &a, vec3 &b)
+{
+    int axis = i / 4;
+    int u = (axis + 1) % 3;
+    int v = (axis + 2) % 3;
+    a[u] = b[u] = (i & 1) ? h[u] : -h[u];
+    a[v] = b[v] = (i & 2) ? h[v] : -h[v];
+    a[axis] = -h[axis];
+    b[axis] = h[axis];
+}
+
+static vec3 getBoxCorner(const vec3 &h, int i)
+{
+    return vec3((i & 1) ? h.x : -h.x, (i & 2) ? h.y : -h.y, (i & 4) ? h.z : -h.z);
+}
+
+// Which feature of the box with half size h the point q on its surface is on
+static ColGeom getBoxFeature(const vec3 &q, const vec3 &h)
+{
+    int sides = (fabs(q.x) >= h.x) + (fabs(q.y) >= h.y) + (fabs(q.z) >= h.z);
+    return sides <= 1 ? FACE : sides == 2 ? EDGE : VERT;
+}
+
+// For a point p inside the box with half size h, the outward normal of the face
+// it's closest to, and how far it is from it
+static vec3 getNearestBoxFace(const vec3 &p, const vec3 &h, float &depth)
+{
+    int axis = 0;
+    depth = h.x - fabs(p.x);
+    for (int k = 1; k < 3; k++)
+    {
+        if (h[k] - fabs(p[k]) < depth)
         {
-            vector<vec3> v = meshCol->mesh->getEdge(i, M);
+            depth = h[k] - fabs(p[k]);
+            axis = k;
+        }
+    }
+    vec3 normal(0);
+    normal[axis] = p[axis] < 0 ? -1.0f : 1.0f;
+    return normal;
+}
+
+static vec3 closestPointOnSegment(const vec3 &p, const vec3 &a, const vec3 &b)
+{
+    vec3 ab = b - a;
+    float ab2 = dot(ab, ab);
+    float t = ab2 > 0 ? clamp(dot(p - a, ab) / ab2, 0.0f, 1.0f) : 0.0f;
+    return a + ab * t;
+}
 
-            if (edgeSet.find(Edge(v[0], v[1])) != edgeSet.end())
+// Closest points c1 on segment p1 q1 and c2 on segment p2 q2
+// Real-Time Collision Detection (5.1.9)
+static void closestPointsOnSegments(const vec3 &p1, const vec3 &q1, const vec3 &p2, const vec3 &q2, vec3 &c1, vec3 &c2)
+{
+    vec3 d1 = q1 - p1;
+    vec3 d2 = q2 - p2;
+    vec3 r = p1 - p2;
+    float a = dot(d1, d1);
+    float e = dot(d2, d2);
+    float f = dot(d2, r);
+    float s = 0;
+    float t = 0;
+    if (a <= 1e-12f && e <= 1e-12f)
+    {
+        // both are points
+    }
+    else if (a <= 1e-12f)
+    {
+        t = clamp(f / e, 0.0f, 1.0f);
+    }
+    else
+    {
+        float c = dot(d1, r);
+        if (e <= 1e-12f)
+        {
+            s = clamp(-c / a, 0.0f, 1.0f);
+        }
+        else
+        {
+            float b = dot(d1, d2);
+            float denom = a * e - b * b;
+            s = denom > 0 ? clamp((b * f - c * e) / denom, 0.0f, 1.0f) : 0.0f;
+            t = (b * s + f) / e;
+            if (t < 0)
             {
-                // skip edge if it's in the set
-                continue;
+                t = 0;
+                s = clamp(-c / a, 0.0f, 1.0f);
             }
+            else if (t > 1)
+            {
+                t = 1;
+                s = clamp((b - c) / a, 0.0f, 1.0f);
+            }
+        }
+    }
+    c1 = p1 + d1 * s;
+    c2 = p2 + d2 * t;
+}
+
+// Reports a contact to both colliders. normal points from a to b, and geomA and
+// geomB are what a and b touched on the other.
+static void addContactPair(PhysicsObject *a, Collider *colA, ColGeom geomA, PhysicsObject *b, Collider *colB, ColGeom geomB,
+    const vec3 &normal, float penetration, const vec3 &pos)
+{
+    Collision collision;
+    collision.other = b;
+    collision.normal = normal;
+    collision.penetration = penetration;
+    collision.geom = geomA;
+    collision.v[0] = pos;
+    collision.pos = pos;
+    addCollision(a, collision);
+
+    collision.other = a;
+    collision.normal = -normal;
+    collision.geom = geomB;
+    addCollision(b, collision);
+}
+
+// Contact between spheres around centerA and centerB, used for the round parts of
+// spheres and capsules
+static void addSphereContact(PhysicsObject *a, Collider *colA, const vec3 &centerA, float radiusA,
+    PhysicsObject *b, Collider *colB, const vec3 &centerB, float radiusB)
+{
+    float d2 = distance2(centerA, centerB);
+    if (d2 >= (radiusA + radiusB) * (radiusA + radiusB))
+    {
+        return;
+    }
+    float d = sqrt(d2);
+    vec3 normal = d > 0 ? (centerB - centerA) / d : vec3(0, 1, 0);
+    addContactPair(a, colA, SPHERE, b, colB, SPHERE, normal, radiusA + radiusB - d, centerB - normal * radiusB);
+}
+
+void checkSphereBox(PhysicsObject *sphere, ColliderSphere *sphereCol, PhysicsObject *box, ColliderBox *boxCol)
+{
+    float radius = sphere->getRadius();
+    if (distance2(sphere->position, box->position) >= pow(radius + box->getRadius(), 2))
+    {
+        return;
+    }
+
+    OrientedBox b = getOrientedBox(box, boxCol);
+    vec3 p = toBox(b, sphere->position);
+    vec3 closest = clamp(p, -b.halfSize, b.halfSize);
+    vec3 normal;
+    float penetration;
+    ColGeom geom;
+    if (closest == p)
+    {
+        // the center is inside, push it out of the nearest face
+        float depth;
+        vec3 face = getNearestBoxFace(p, b.halfSize, depth);
+        closest = p + face * depth;
+        normal = -face;
+        penetration = radius + depth;
+        geom = FACE;
+    }
+    else
+    {
+        float d = distance(p, closest);
+        if (d >= radius)
+        {
+            return;
+        }
+        normal = (closest - p) / d;
+        penetration = radius - d;
+        geom = getBoxFeature(closest, b.halfSize);
+    }
+    addContactPair(sphere, sphereCol, geom, box, boxCol, SPHERE, fromBoxDirection(b, normal), penetration, fromBox(b, closest));
+}
+
+void checkSphereCapsule(PhysicsObject *sphere, ColliderSphere *sphereCol, PhysicsObject *capsule, ColliderCapsule *capsuleCol)
+{
+    vec3 p0, p1;
+    float r;
+    capsuleCol->getSegment(capsule, p0, p1, r);
+    vec3 closest = closestPointOnSegment(sphere->position, p0, p1);
+    addSphereContact(sphere, sphereCol, sphere->position, sphere->getRadius(), capsule, capsuleCol, closest, r);
+}
 
-            vec3 closestPoint = v[0] + proj(sphere->position - v[0], normalize(v[1] - v[0]));
-            float d = distance(sphere->position, closestPoint);
+void checkCapsuleCapsule(PhysicsObject *capsule1, ColliderCapsule *capsuleCol1, PhysicsObject *capsule2, ColliderCapsule *capsuleCol2)
+{
+    vec3 a0, a1, b0, b1, ca, cb;
+    float ra, rb;
+    capsuleCol1->getSegment(capsule1, a0, a1, ra);
+    capsuleCol2->getSegment(capsule2, b0, b1, rb);
+    closestPointsOnSegments(a0, a1, b0, b1, ca, cb);
+    addSphereContact(capsule1, capsuleCol1, ca, ra, capsule2, capsuleCol2, cb, rb);
+}
 
-            if (d < sphere->getRadius() &&
-                dot(v[1] - v[0], closestPoint - v[0]) > 0 && dot(v[0] - v[1], closestPoint - v[1]) > 0)
+// Clips the segment p0 p1 to the box with half size h centered on the origin.
+// Returns false if it misses, otherwise t0 to t1 is the part inside.
+static bool clipSegmentToBox(const vec3 &p0, const vec3 &p1, const vec3 &h, float &t0, float &t1)
+{
+    vec3 d = p1 - p0;
+    t0 = 0;
+    t1 = 1;
+    for (int k = 0; k < 3; k++)
+    {
+        if (fabs(d[k]) < 1e-12f)
+        {
+            if (fabs(p0[k]) > h[k])
             {
-                Collision collision;
-                collision.other = mesh;
-                collision.normal = normalize(closestPoint - sphere->position);
-                collision.penetration = sphere->getRadius() - d;
-                collision.geom = EDGE;
-                collision.pos = closestPoint;
-                sphereCol->pendingCollisions.push_back(collision);
-
-                // add vertices of edge to set of vertices we souldn't check 
-                vertSet.insert(v[0]);
-                vertSet.insert(v[1]);
+                return false;
             }
+            continue;
+        }
+        float near = (-h[k] - p0[k]) / d[k];
+        float far = (h[k] - p0[k]) / d[k];
+        if (near > far)
+        {
+            swap(near, far);
+        }
+        t0 = (std::max)(t0, near);
+        t1 = (std::min)(t1, far);
+        if (t0 > t1)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+void checkCapsuleBox(PhysicsObject *capsule, ColliderCapsule *capsuleCol, PhysicsObject *box, ColliderBox *boxCol)
+{
+    if (distance2(capsule->position, box->position) >= pow(capsule->getRadius() + box->getRadius(), 2))
+    {
+        return;
+    }
+
+    vec3 p0, p1;
+    float r;
+    capsuleCol->getSegment(capsule, p0, p1, r);
+    OrientedBox b = getOrientedBox(box, boxCol);
+    p0 = toBox(b, p0);
+    p1 = toBox(b, p1);
+    const vec3 &h = b.halfSize;
+
+    float t0, t1;
+    if (clipSegmentToBox(p0, p1, h, t0, t1))
+    {
+        // the segment goes through the box, push the middle of the part inside out of the nearest face
+        vec3 inside = p0 + (p1 - p0) * ((t0 + t1) * 0.5f);
+        float depth;
+        vec3 face = getNearestBoxFace(inside, h, depth);
+        addContactPair(capsule, capsuleCol, FACE, box, boxCol, SPHERE,
+            fromBoxDirection(b, -face), r + depth, fromBox(b, inside + face * depth));
+        return;
+    }
+
+    // Otherwise the closest points are either an end of the segment and the point of
+    // the box nearest it, or on the segment and one of the box edges
+    vec3 segPoint = p0;
+    vec3 boxPoint = clamp(p0, -h, h);
+    float best = distance2(segPoint, boxPoint);
+    vec3 end = clamp(p1, -h, h);
+    if (distance2(p1, end) < best)
+    {
+        segPoint = p1;
+        boxPoint = end;
+        best = distance2(p1, end);
+    }
+    for (int i = 0; i < 12; i++)
+    {
+        vec3 a, e, cs, ce;
+        getBoxEdge(h, i, a, e);
+        closestPointsOnSegments(p0, p1, a, e, cs, ce);
+        float d2 = distance2(cs, ce);
+        if (d2 < best)
+        {
+            segPoint = cs;
+            boxPoint = ce;
+            best = d2;
+        }
+    }
+    if (best >= r * r)
+    {
+        return;
+    }
+
+    float d = sqrt(best);
+    vec3 normal = (boxPoint - segPoint) / d;
+    addContactPair(capsule, capsuleCol, getBoxFeature(boxPoint, h), box, boxCol, SPHERE,
+        fromBoxDirection(b, normal), r - d, fromBox(b, boxPoint));
+}
+
+// Separating axis test, Real-Time Collision Detection (4.4.1). The axis with the
+// least overlap gives the normal, and the contact is the deepest corner of one box
+// against a face of the other, or the closest points of two edges.
+void checkBoxBox(PhysicsObject *box1, ColliderBox *boxCol1, PhysicsObject *box2, ColliderBox *boxCol2)
+{
+    if (distance2(box1->position, box2->position) >= pow(box1->getRadius() + box2->getRadius(), 2))
+    {
+        return;
+    }
+
+    OrientedBox a = getOrientedBox(box1, boxCol1);
+    OrientedBox b = getOrientedBox(box2, boxCol2);
+    vec3 d = b.center - a.center;
+
+    float best = INFINITY;
+    vec3 normal;
+    int bestType = 0; // 0 for a face of a, 1 for a face of b, 2 for an edge of each
+    int bestA = 0;
+    int bestB = 0;
+    auto testAxis = [&](vec3 axis, int type, int i, int j)
+    {
+        float ra = a.halfSize.x * fabs(dot(a.axis[0], axis)) + a.halfSize.y * fabs(dot(a.axis[1], axis)) + a.halfSize.z * fabs(dot(a.axis[2], axis));
+        float rb = b.halfSize.x * fabs(dot(b.axis[0], axis)) + b.halfSize.y * fabs(dot(b.axis[1], axis)) + b.halfSize.z * fabs(dot(b.axis[2], axis));
+        float dist = dot(d, axis);
+        float overlap = ra + rb - fabs(dist);
+        if (overlap < 0)
+        {
+            return false;
+        }
+        // edge contacts only win when they're clearly better, so resting boxes stay on their faces
+        if (overlap < (type == 2 ? best * 0.95f : best))
+        {
+            best = overlap;
+            normal = dist < 0 ? -axis : axis;
+            bestType = type;
+            bestA = i;
+            bestB = j;
         }
+        return true;
+    };
 
-        // check vertices
-        for (int i = 0; i < meshCol->mesh->getNumVertices(); i++)
+    for (int i = 0; i < 3; i++)
+    {
+        if (!testAxis(a.axis[i], 0, i, 0))
+        {
+            return;
+        }
+    }
+    for (int j = 0; j < 3; j++)
+    {
+        if (!testAxis(b.axis[j], 1, 0, j))
+        {
+            return;
+        }
+    }
+    for (int i = 0; i < 3; i++)
+    {
+        for (int j = 0; j < 3; j++)
         {
-            vec3 v = meshCol->mesh->getVertex(i, M);
+            // parallel edges are already covered by the face axes
+            vec3 axis = cross(a.axis[i], b.axis[j]);
+            float len = length(axis);
+            if (len > 1e-5f && !testAxis(axis / len, 2, i, j))
+            {
+                return;
+            }
+        }
+    }
+
+    if (bestType == 0)
+    {
+        // corner of b in a face of a
+        vec3 pos = boxSupport(b, -normal) + normal * best;
+        addContactPair(box1, boxCol1, VERT, box2, boxCol2, FACE, normal, best, pos);
+    }
+    else if (bestType == 1)
+    {
+        // corner of a in a face of b
+        vec3 pos = boxSupport(a, normal) - normal * best;
+        addContactPair(box1, boxCol1, FACE, box2, boxCol2, VERT, normal, best, pos);
+    }
+    else
+    {
+        // the edge of each box along the chosen axes that's nearest the other box
+        vec3 edgeA = boxSupport(a, normal) - a.axis[bestA] * (dot(a.axis[bestA], normal) >= 0 ? a.halfSize[bestA] : -a.halfSize[bestA]);
+        vec3 edgeB = boxSupport(b, -normal) - b.axis[bestB] * (dot(b.axis[bestB], -normal) >= 0 ? b.halfSize[bestB] : -b.halfSize[bestB]);
+        vec3 ca, cb;
+        closestPointsOnSegments(edgeA - a.axis[bestA] * a.halfSize[bestA], edgeA + a.axis[bestA] * a.halfSize[bestA],
+            edgeB - b.axis[bestB] * b.halfSize[bestB], edgeB + b.axis[bestB] * b.halfSize[bestB], ca, cb);
+        addContactPair(box1, boxCol1, EDGE, box2, boxCol2, EDGE, normal, best, (ca + cb) * 0.5f);
+    }
+}
+
+float sweepSphereBox(PhysicsObject *sphere, ColliderSphere *sphereCol, vec3 start, PhysicsObject *box, ColliderBox *boxCol)
+{
+    float radius = sphere->getRadius();
+    vec3 move = sphere->position - start;
+    vec3 center = start + move * 0.5f;
+    float sweptRadius = radius + length(move) * 0.5f;
+    if (distance2(center, box->position) > pow(sweptRadius + box->getRadius(), 2))
+    {
+        return 1;
+    }
+
+    OrientedBox b = getOrientedBox(box, boxCol);
+    vec3 s = toBox(b, start);
+    vec3 m = toBoxDirection(b, move);
+    const vec3 &h = b.halfSize;
+    float r = radius * (1 - SWEEP_SKIN);
+    if (distance2(s, clamp(s, -h, h)) <= r * r)
+    {
+        // already touching, that's left to the collision test
+        return 1;
+    }
 
-            if (vertSet.find(v) != vertSet.end())
+    float first = 1;
+    float t;
+    // the faces, pushed out by r
+    for (int k = 0; k < 3; k++)
+    {
+        for (int side = -1; side <= 1; side += 2)
+        {
+            float plane = side * (h[k] + r);
+            if (side * s[k] < h[k] + r || side * m[k] >= 0)
             {
-                // skip vertex if it's in the set
                 continue;
             }
-
-            float d = distance(sphere->position, v);
-            if (d < sphere->getRadius())
+            t = (plane - s[k]) / m[k];
+            vec3 p = s + m * t;
+            int u = (k + 1) % 3;
+            int v = (k + 2) % 3;
+            if (t < first && fabs(p[u]) <= h[u] && fabs(p[v]) <= h[v])
             {
-                Collision collision;
-                collision.other = mesh;
-                collision.normal = normalize(v - sphere->position);
-                collision.penetration = sphere->getRadius() - d;
-                collision.geom = VERT;
-                collision.pos = v;
-                sphereCol->pendingCollisions.push_back(collision);
+                first = t;
             }
         }
     }
-}
\ No newline at end of file
+    // the rounded edges and corners
+    for (int i = 0; i < 12; i++)
+    {
+        vec3 e0, e1;
+        getBoxEdge(h, i, e0, e1);
+        if (sweepSphereSegment(s, m, r, e0, e1, t) && t < first)
+        {
+            first = t;
+        }
+    }
+    for (int i = 0; i < 8; i++)
+    {
+        if (sweepSpherePoint(s, m, r, getBoxCorner(h, i), t) && t < first)
+        {
+            first = t;
+        }
+    }
+    return first;
+}
+
+float sweepSphereCapsule(PhysicsObject *sphere, ColliderSphere *sphereCol, vec3 start, PhysicsObject *capsule, ColliderCapsule *capsuleCol)
+{
+    vec3 p0, p1;
+    float r;
+    capsuleCol->getSegment(capsule, p0, p1, r);
+    float radius = (sphere->getRadius() + r) * (1 - SWEEP_SKIN);
+    vec3 move = sphere->position - start;
+
+    float first = 1;
+    float t;
+    if (sweepSphereSegment(start, move, radius, p0, p1, t) && t < first)
+    {
+        first = t;
+    }
+    if (sweepSpherePoint(start, move, radius, p0, t) && t < first)
+    {
+        first = t;
+    }
+    if (sweepSpherePoint(start, move, radius, p1, t) && t < first)
+    {
+        first = t;
+    }
+    return first;
+}
+
+
+
+// Convex hull tests. These all go through testConvex with each shape given by its
+// support function. Spheres and capsules are tested as the point or segment through
+// their middle so that GJK only has to find a distance, EPA is only needed once the
+// middle is inside the hull.
+
+// A ColliderConvex in world space. The hull stays in local space, directions are
+// turned into it and support points back out.
+class HullSupport : public SupportShape
+{
+public:
+    HullSupport(PhysicsObject *obj, ColliderConvex *col) :
+        hull(&col->hull), R(mat3_cast(obj->orientation)), toLocal(transpose(R)), position(obj->position), scale(obj->scale)
+    {
+    }
+
+    virtual vec3 support(const vec3 &dir) const
+    {
+        return position + R * (scale * hull->support(scale * (toLocal * dir)));
+    }
+
+    // The world space normal of the face that faces dir the most
+    vec3 getFaceNormal(const vec3 &dir) const
+    {
+        return normalize(R * (hull->getFaceNormal((toLocal * dir) / scale) / scale));
+    }
+
+private:
+    const ConvexHull *hull;
+    mat3 R;
+    mat3 toLocal;
+    vec3 position;
+    vec3 scale;
+};
+
+class PointSupport : public SupportShape
+{
+public:
+    PointSupport(const vec3 &p) : p(p) {}
+
+    virtual vec3 support(const vec3 &dir) const
+    {
+        return p;
+    }
+
+private:
+    vec3 p;
+};
+
+class SegmentSupport : public SupportShape
+{
+public:
+    SegmentSupport(const vec3 &p0, const vec3 &p1) : p0(p0), p1(p1) {}
+
+    virtual vec3 support(const vec3 &dir) const
+    {
+        return dot(p1 - p0, dir) > 0 ? p1 : p0;
+    }
+
+private:
+    vec3 p0;
+    vec3 p1;
+};
+
+class BoxSupport : public SupportShape
+{
+public:
+    BoxSupport(const OrientedBox &box) : box(box) {}
+
+    virtual vec3 support(const vec3 &dir) const
+    {
+        return boxSupport(box, dir);
+    }
+
+private:
+    OrientedBox box;
+};
+
+class TriangleSupport : public SupportShape
+{
+public:
+    TriangleSupport(const vec3 v[3]) : v(v) {}
+
+    virtual vec3 support(const vec3 &dir) const
+    {
+        float d0 = dot(v[0], dir);
+        float d1 = dot(v[1], dir);
+        float d2 = dot(v[2], dir);
+        return d0 >= d1 && d0 >= d2 ? v[0] : d1 >= d2 ? v[1] : v[2];
+    }
+
+private:
+    const vec3 *v;
+};
+
+// EPA finds the shortest way out, which for shapes resting on each other is often
+// across an edge, and pushes them sideways. Like in checkBoxBox a face normal wins
+// unless the other way out is clearly shorter. normal points from a to b.
+static void preferFaceNormal(const SupportShape &a, const SupportShape &b, const vec3 &normal, ConvexContact &contact)
+{
+    float overlap = dot(a.support(normal) - b.support(-normal), normal);
+    if (overlap * 0.95f <= contact.depth)
+    {
+        contact.normal = normal;
+        contact.depth = overlap;
+    }
+}
+
+static vec3 getBoxFaceNormal(const OrientedBox &b, const vec3 &dir)
+{
+    vec3 local = toBoxDirection(b, dir);
+    vec3 normal(0);
+    int axis = fabs(local.x) >= fabs(local.y) && fabs(local.x) >= fabs(local.z) ? 0 : fabs(local.y) >= fabs(local.z) ? 1 : 2;
+    normal[axis] = local[axis] < 0 ? -1.0f : 1.0f;
+    return fromBoxDirection(b, normal);
+}
+
+// A sphere or capsule, given by the point or segment through its middle and its
+// radius, against a hull
+static void checkRoundConvex(PhysicsObject *obj, Collider *col, const SupportShape &middle, float radius,
+    PhysicsObject *convex, ColliderConvex *convexCol)
+{
+    HullSupport hull(convex, convexCol);
+    ConvexContact contact;
+    if (!testConvex(middle, hull, contact))
+    {
+        return;
+    }
+    float penetration;
+    if (contact.overlap)
+    {
+        penetration = contact.depth + radius;
+    }
+    else if (contact.distance < radius)
+    {
+        penetration = radius - contact.distance;
+    }
+    else
+    {
+        return;
+    }
+    addContactPair(obj, col, CONVEX, convex, convexCol, SPHERE, contact.normal, penetration, contact.pointB);
+}
+
+void checkSphereConvex(PhysicsObject *sphere, ColliderSphere *sphereCol, PhysicsObject *convex, ColliderConvex *convexCol)
+{
+    if (distance2(sphere->position, convex->getCenterPos()) >= pow(sphere->getRadius() + convex->getRadius(), 2))
+    {
+        return;
+    }
+    checkRoundConvex(sphere, sphereCol, PointSupport(sphere->position), sphere->getRadius(), convex, convexCol);
+}
+
+void checkCapsuleConvex(PhysicsObject *capsule, ColliderCapsule *capsuleCol, PhysicsObject *convex, ColliderConvex *convexCol)
+{
+    if (distance2(capsule->position, convex->getCenterPos()) >= pow(capsule->getRadius() + convex->getRadius(), 2))
+    {
+        return;
+    }
+    vec3 p0, p1;
+    float r;
+    capsuleCol->getSegment(capsule, p0, p1, r);
+    checkRoundConvex(capsule, capsuleCol, SegmentSupport(p0, p1), r, convex, convexCol);
+}
+
+void checkBoxConvex(PhysicsObject *box, ColliderBox *boxCol, PhysicsObject *convex, ColliderConvex *convexCol)
+{
+    if (distance2(box->position, convex->getCenterPos()) >= pow(box->getRadius() + convex->getRadius(), 2))
+    {
+        return;
+    }
+    OrientedBox b = getOrientedBox(box, boxCol);
+    BoxSupport boxShape(b);
+    HullSupport hull(convex, convexCol);
+    ConvexContact contact;
+    if (testConvex(boxShape, hull, contact) && contact.overlap)
+    {
+        preferFaceNormal(boxShape, hull, -hull.getFaceNormal(-contact.normal), contact);
+        preferFaceNormal(boxShape, hull, getBoxFaceNormal(b, contact.normal), contact);
+        addContactPair(box, boxCol, CONVEX, convex, convexCol, getBoxFeature(toBox(b, contact.pointA), b.halfSize * 0.999f),
+            contact.normal, contact.depth, (contact.pointA + contact.pointB) * 0.5f);
+    }
+}
+
+void checkConvexConvex(PhysicsObject *convex1, ColliderConvex *convexCol1, PhysicsObject *convex2, ColliderConvex *convexCol2)
+{
+    if (distance2(convex1->getCenterPos(), convex2->getCenterPos()) >= pow(convex1->getRadius() + convex2->getRadius(), 2))
+    {
+        return;
+    }
+    HullSupport hull1(convex1, convexCol1);
+    HullSupport hull2(convex2, convexCol2);
+    ConvexContact contact;
+    if (testConvex(hull1, hull2, contact) && contact.overlap)
+    {
+        preferFaceNormal(hull1, hull2, -hull2.getFaceNormal(-contact.normal), contact);
+        preferFaceNormal(hull1, hull2, hull1.getFaceNormal(contact.normal), contact);
+        addContactPair(convex1, convexCol1, CONVEX, convex2, convexCol2, CONVEX,
+            contact.normal, contact.depth, (contact.pointA + contact.pointB) * 0.5f);
+    }
+}
+
+// Each triangle near the hull is its own convex shape. Like with spheres only the
+// fronts of faces collide, and a hull resting on a face ignores the edges it's
+// touching so that it doesn't catch on the seams between triangles.
+void checkConvexMesh(PhysicsObject *convex, ColliderConvex *convexCol, PhysicsObject *mesh, ColliderMesh *meshCol)
+{
+    static thread_local vector<int> faces;
+    static thread_local vector<Collision> edgeCollisions;
+
+    float radius = convex->getRadius();
+    vec3 center = convex->getCenterPos();
+    if (distance2(center, mesh->getCenterPos()) >= pow(radius + mesh->getRadius(), 2))
+    {
+        return;
+    }
+
+    // Triangles near the hull, using its bounding sphere's bounds in mesh space
+    Shape *shape = meshCol->mesh.get();
+    vec3 localCenter = (inverse(mesh->orientation) * (center - mesh->position)) / mesh->scale;
+    vec3 localExtent = radius / abs(mesh->scale);
+    faces.clear();
+    shape->bvh.query(localCenter - localExtent, localCenter + localExtent, faces);
+
+    mat4 M = translate(mat4(1.f), mesh->position) * mat4_cast(mesh->orientation) * scale(mat4(1.f), mesh->scale);
+    HullSupport hull(convex, convexCol);
+    bool onFace = false;
+    edgeCollisions.clear();
+    for (int i : faces)
+    {
+        vec3 v[3];
+        shape->getFace(i, M, v);
+        vec3 normal = cross(v[1] - v[0], v[2] - v[0]);
+        if (normal == vec3(0))
+        {
+            continue;
+        }
+        normal = normalize(normal);
+
+        TriangleSupport triangle(v);
+        ConvexContact contact;
+        if (!testConvex(hull, triangle, contact) || !contact.overlap || dot(contact.normal, normal) >= 0)
+        {
+            continue;
+        }
+        preferFaceNormal(hull, triangle, -normal, contact);
+
+        Collision collision;
+        collision.other = mesh;
+        collision.penetration = contact.depth;
+        collision.pos = contact.pointB;
+        collision.normal = contact.normal;
+        collision.feature = i;
+        if (contact.normal == -normal)
+        {
+            collision.geom = FACE;
+            collision.v[0] = v[0];
+            collision.v[1] = v[1];
+            collision.v[2] = v[2];
+            addCollision(convex, collision);
+            onFace = true;
+        }
+        else
+        {
+            collision.geom = EDGE;
+            edgeCollisions.push_back(collision);
+        }
+    }
+    if (!onFace)
+    {
+        for (const Collision &collision : edgeCollisions)
+        {
+            addCollision(convex, collision);
+        }
+    }
+}
+
+// Conservative advancement: the distance from a point moving in a straight line
+// to a convex shape never falls faster than it's falling now, so the sphere can
+// safely be moved up by the gap over that rate until it touches.
+float sweepSphereConvex(PhysicsObject *sphere, ColliderSphere *sphereCol, vec3 start, PhysicsObject *convex, ColliderConvex *convexCol)
+{
+    float radius = sphere->getRadius();
+    vec3 move = sphere->position - start;
+    vec3 center = start + move * 0.5f;
+    float sweptRadius = radius + length(move) * 0.5f;
+    if (distance2(center, convex->getCenterPos()) > pow(sweptRadius + convex->getRadius(), 2))
+    {
+        return 1;
+    }
+
+    HullSupport hull(convex, convexCol);
+    float r = radius * (1 - SWEEP_SKIN);
+    float t = 0;
+    for (int i = 0; i < 32; i++)
+    {
+        ConvexContact contact;
+        if (!testConvex(PointSupport(start + move * t), hull, contact) || contact.overlap)
+        {
+            // already touching, that's left to the collision test
+            return i == 0 ? 1 : t;
+        }
+        float gap = contact.distance - r;
+        if (gap <= 0)
+        {
+            return i == 0 ? 1 : t;
+        }
+        if (gap < 1e-4f)
+        {
+            return t;
+        }
+        float closing = dot(move, contact.normal);
+        if (closing <= 0)
+        {
+            return 1;
+        }
+        t += gap / closing;
+        if (t >= 1)
+        {
+            return 1;
+        }
+    }
+    return t;
+}
+
+
+
+// Distance from a world space point to a distance field's surface, and the world
+// space direction away from it. The field is in mesh space, so the distance there
+// is stretched by the scale along the gradient.
+static float distanceToSDF(const vec3 &p, PhysicsObject *sdf, ColliderSDF *sdfCol, vec3 &normal)
+{
+    vec3 local = (inverse(sdf->orientation) * (p - sdf->position)) / sdf->scale;
+    vec3 gradient;
+    float d = sdfCol->getDistance(local, gradient);
+    vec3 world = sdf->orientation * (gradient / sdf->scale);
+    float stretch = length(world);
+    if (stretch == 0)
+    {
+        normal = vec3(0);
+        return d;
+    }
+    normal = world / stretch;
+    return d * length(gradient) / stretch;
+}
+
+void checkSphereSDF(PhysicsObject *sphere, ColliderSphere *sphereCol, PhysicsObject *sdf, ColliderSDF *sdfCol)
+{
+    if (distance2(sphere->getCenterPos(), sdf->getCenterPos()) > pow(sphere->getRadius() + sdf->getRadius(), 2))
+    {
+        return;
+    }
+
+    float radius = sphere->getRadius();
+    vec3 normal;
+    float d = distanceToSDF(sphere->position, sdf, sdfCol, normal);
+    if (d >= radius || normal == vec3(0))
+    {
+        return;
+    }
+
+    // one contact on the surface's tangent plane, which is all the edge filter needs
+    Collision collision;
+    collision.other = sdf;
+    collision.normal = -normal;
+    collision.penetration = radius - d;
+    collision.geom = FACE;
+    collision.pos = sphere->position - normal * d;
+    collision.v[0] = collision.pos;
+    collision.v[1] = collision.pos;
+    collision.v[2] = collision.pos;
+    addCollision(sphere, collision);
+}
+
+// Sphere tracing: the sphere can't get closer to the surface than it is by moving
+// less than the gap, so it's moved along by that much until it touches.
+float sweepSphereSDF(PhysicsObject *sphere, ColliderSphere *sphereCol, vec3 start, PhysicsObject *sdf, ColliderSDF *sdfCol)
+{
+    float radius = sphere->getRadius();
+    vec3 move = sphere->position - start;
+    vec3 center = start + move * 0.5f;
+    float sweptRadius = radius + length(move) * 0.5f;
+    if (distance2(center, sdf->getCenterPos()) > pow(sweptRadius + sdf->getRadius(), 2))
+    {
+        return 1;
+    }
+
+    float r = radius * (1 - SWEEP_SKIN);
+    float moveLength = length(move);
+    float t = 0;
+    for (int i = 0; i < 32; i++)
+    {
+        vec3 normal;
+        float gap = distanceToSDF(start + move * t, sdf, sdfCol, normal) - r;
+        if (gap <= 0)
+        {
+            // already touching, that's left to the collision test
+            return i == 0 ? 1 : t;
+        }
+        if (gap < 1e-4f)
+        {
+            return t;
+        }
+        t += gap / moveLength;
+        if (t >= 1)
+        {
+            return 1;
+        }
+    }
+    return t;
+}
+
+void checkSphereHeightfield(PhysicsObject *sphere, ColliderSphere *sphereCol, PhysicsObject *ground, ColliderHeightfield *groundCol)
+{
+    // Scratch buffer, kept between calls so it doesn't have to be reallocated
+    static thread_local vector<int> faces;
+
+    if (distance2(sphere->getCenterPos(), ground->getCenterPos()) > pow(sphere->getRadius() + ground->getRadius(), 2))
+    {
+        return;
+    }
+
+    // The cells under the sphere's bounds in heightfield space
+    float radius = sphere->getRadius();
+    vec3 localCenter = (inverse(ground->orientation) * (sphere->position - ground->position)) / ground->scale;
+    vec3 localExtent = radius / abs(ground->scale);
+    faces.clear();
+    groundCol->query(localCenter - localExtent, localCenter + localExtent, faces);
+    if (faces.empty())
+    {
+        return;
+    }
+
+    mat4 M = translate(mat4(1.f), ground->position) * mat4_cast(ground->orientation) * scale(mat4(1.f), ground->scale);
+    collideSphereTriangles(sphere, ground, *groundCol, M, faces);
+}
+
+float sweepSphereHeightfield(PhysicsObject *sphere, ColliderSphere *sphereCol, vec3 start, PhysicsObject *ground, ColliderHeightfield *groundCol)
+{
+    static thread_local vector<int> faces;
+
+    float radius = sphere->getRadius();
+    vec3 move = sphere->position - start;
+    vec3 center = start + move * 0.5f;
+    float sweptRadius = radius + length(move) * 0.5f;
+    if (distance2(center, ground->getCenterPos()) > pow(sweptRadius + ground->getRadius(), 2))
+    {
+        return 1;
+    }
+
+    quat invOrientation = inverse(ground->orientation);
+    vec3 localStart = (invOrientation * (start - ground->position)) / ground->scale;
+    vec3 localEnd = (invOrientation * (sphere->position - ground->position)) / ground->scale;
+    vec3 localExtent = radius / abs(ground->scale);
+    faces.clear();
+    groundCol->query(min(localStart, localEnd) - localExtent, max(localStart, localEnd) + localExtent, faces);
+
+    mat4 M = translate(mat4(1.f), ground->position) * mat4_cast(ground->orientation) * scale(mat4(1.f), ground->scale);
+    return sweepSphereTriangles(start, move, radius * (1 - SWEEP_SKIN), *groundCol, M, faces);
+}
+
+// The pair tests take their colliders as the classes they are. These wrap them to
+// take any Collider so they fit in one table, with a version for each order.
+template <class A, class B, void (*test)(PhysicsObject *, A *, PhysicsObject *, B *)>
+static void collide(PhysicsObject *a, Collider *colA, PhysicsObject *b, Collider *colB)
+{
+    test(a, static_cast<A *>(colA), b, static_cast<B *>(colB));
+}
+
+template <class A, class B, void (*test)(PhysicsObject *, A *, PhysicsObject *, B *)>
+static void collideSwapped(PhysicsObject *b, Collider *colB, PhysicsObject *a, Collider *colA)
+{
+    test(a, static_cast<A *>(colA), b, static_cast<B *>(colB));
+}
+
+template <class B, float (*test)(PhysicsObject *, ColliderSphere *, vec3, PhysicsObject *, B *)>
+static float sweepAgainst(PhysicsObject *sphere, ColliderSphere *sphereCol, vec3 start, PhysicsObject *obj, Collider *col)
+{
+    return test(sphere, sphereCol, start, obj, static_cast<B *>(col));
+}
+
+// Rows are the first collider's type and columns the second's, in ColliderType order
+static const CollisionTest collisionTests[NUM_COLLIDER_TYPES][NUM_COLLIDER_TYPES] = {
+    {
+        collide<ColliderSphere, ColliderSphere, checkSphereSphere>,
+        collide<ColliderSphere, ColliderBox, checkSphereBox>,
+        collide<ColliderSphere, ColliderCapsule, checkSphereCapsule>,
+        collide<ColliderSphere, ColliderConvex, checkSphereConvex>,
+        collide<ColliderSphere, ColliderMesh, checkSphereMesh>,
+        collide<ColliderSphere, ColliderSDF, checkSphereSDF>,
+        collide<ColliderSphere, ColliderHeightfield, checkSphereHeightfield>
+    },
+    {
+        collideSwapped<ColliderSphere, ColliderBox, checkSphereBox>,
+        collide<ColliderBox, ColliderBox, checkBoxBox>,
+        collideSwapped<ColliderCapsule, ColliderBox, checkCapsuleBox>,
+        collide<ColliderBox, ColliderConvex, checkBoxConvex>,
+        nullptr,
+        nullptr,
+        nullptr
+    },
+    {
+        collideSwapped<ColliderSphere, ColliderCapsule, checkSphereCapsule>,
+        collide<ColliderCapsule, ColliderBox, checkCapsuleBox>,
+        collide<ColliderCapsule, ColliderCapsule, checkCapsuleCapsule>,
+        collide<ColliderCapsule, ColliderConvex, checkCapsuleConvex>,
+        nullptr,
+        nullptr,
+        nullptr
+    },
+    {
+        collideSwapped<ColliderSphere, ColliderConvex, checkSphereConvex>,
+        collideSwapped<ColliderBox, ColliderConvex, checkBoxConvex>,
+        collideSwapped<ColliderCapsule, ColliderConvex, checkCapsuleConvex>,
+        collide<ColliderConvex, ColliderConvex, checkConvexConvex>,
+        collide<ColliderConvex, ColliderMesh, checkConvexMesh>,
+        nullptr,
+        nullptr
+    },
+    {
+        collideSwapped<ColliderSphere, ColliderMesh, checkSphereMesh>,
+        nullptr,
+        nullptr,
+        collideSwapped<ColliderConvex, ColliderMesh, checkConvexMesh>,
+        nullptr,
+        nullptr,
+        nullptr
+    },
+    {
+        collideSwapped<ColliderSphere, ColliderSDF, checkSphereSDF>,
+        nullptr,
+        nullptr,
+        nullptr,
+        nullptr,
+        nullptr,
+        nullptr
+    },
+    {
+        collideSwapped<ColliderSphere, ColliderHeightfield, checkSphereHeightfield>,
+        nullptr,
+        nullptr,
+        nullptr,
+        nullptr,
+        nullptr,
+        nullptr
+    }
+};
+
+static const SweepTest sweepTests[NUM_COLLIDER_TYPES] = {
+    sweepAgainst<ColliderSphere, sweepSphereSphere>,
+    sweepAgainst<ColliderBox, sweepSphereBox>,
+    sweepAgainst<ColliderCapsule, sweepSphereCapsule>,
+    sweepAgainst<ColliderConvex, sweepSphereConvex>,
+    sweepAgainst<ColliderMesh, sweepSphereMesh>,
+    sweepAgainst<ColliderSDF, sweepSphereSDF>,
+    sweepAgainst<ColliderHeightfield, sweepSphereHeightfield>
+};
+
+CollisionTest getCollisionTest(ColliderType a, ColliderType b)
+{
+    return collisionTests[a][b];
+}
+
+SweepTest getSweepTest(ColliderType type)
+{
+    return sweepTests[type];
+}
@@ -3,7 +3,6 @@
 #include "BoundingBox.h"
 
 #define GLM_ENABLE_EXPERIMENTAL
-#include <glm/gtx/hash.hpp>
 #include <glm/gtx/intersect.hpp>
 #include <glm/gtx/norm.hpp>
 #include <glm/gtx/projection.hpp>
@@ -13,7 +12,6 @@
 #include <cmath>
 #include <iostream>
 #include <algorithm>
-#include <unordered_set>
 
 // https://eli.thegreenplace.net/2016/a-polyglots-guide-to-multiple-dispatch/
 // https://gamedevelopment.tutsplus.com/tutorials/how-to-create-a-custom-2d-physics-engine-the-basics-and-impulse-resolution--gamedev-6331
@@ -23,63 +21,80 @@ using namespace std;
 
 class ColliderMesh;
 class ColliderSphere;
+class ColliderBox;
+class ColliderCapsule;
+class ColliderConvex;
+class ColliderSDF;
+class ColliderHeightfield;
 class PhysicsObject;
 
-enum ColGeom {FACE, EDGE, VERT, SPHERE};
+enum ColGeom {FACE, EDGE, VERT, SPHERE, CONVEX};
 
 struct Collision {
     PhysicsObject *other;
     float penetration;
     vec3 normal;
     ColGeom geom;
+    // Which face, edge or vertex of other was touched, so the contact can be
+    // matched up with the same one next step. 0 when there's one contact per pair.
+    unsigned int feature = 0;
 
     vec3 v[3];
     vec3 pos;
 };
 
+// Which class a collider is. The pair tests are looked up by the types of both
+// colliders instead of going through virtual calls.
+enum ColliderType {COLLIDER_SPHERE, COLLIDER_BOX, COLLIDER_CAPSULE, COLLIDER_CONVEX, COLLIDER_MESH, COLLIDER_SDF, COLLIDER_HEIGHTFIELD, NUM_COLLIDER_TYPES};
+
 class Collider
 {
 public:
-    Collider(vec3 min, vec3 max);
-    Collider(float radius);
-
-    virtual void checkCollision(PhysicsObject *owner, PhysicsObject *obj, Collider *col) = 0;
-    virtual void checkCollision(PhysicsObject *owner, PhysicsObject *obj, ColliderMesh *col) {};
-    virtual void checkCollision(PhysicsObject *owner, PhysicsObject *obj, ColliderSphere *col) {};
+    Collider(ColliderType type, vec3 min, vec3 max);
+    Collider(ColliderType type, float radius);
 
-    virtual void clearCollisions(PhysicsObject *owner);
     virtual float getRadius(vec3 scale) = 0;
 
+    const ColliderType type;
     BoundingBox bbox;
-
-    vector<Collision> pendingCollisions;
 };
 
-void checkSphereMesh(PhysicsObject *sphere, ColliderSphere *sphereCol, PhysicsObject *mesh, ColliderMesh *meshCol);
-void checkSphereSphere(PhysicsObject *sphere1, ColliderSphere *sphereCol1, PhysicsObject *sphere2, ColliderSphere *sphereCol2);
-
-
-// Used for inserting pairs of vertices into a hash set
-struct Edge
-{
-    vec3 v0, v1;
-
-    Edge(vec3 v0, vec3 v1) : v0(v0), v1(v1)
-    {
-    }
+// Tests a pair of objects with colliders of types a and b, in that order
+typedef void (*CollisionTest)(PhysicsObject *a, Collider *colA, PhysicsObject *b, Collider *colB);
+// Continuous collision: the sphere moved from start to where it is now. Returns how
+// far along that move (0 to 1) it first touches obj, or 1 if it doesn't. Only
+// spheres sweep.
+typedef float (*SweepTest)(PhysicsObject *sphere, ColliderSphere *sphereCol, vec3 start, PhysicsObject *obj, Collider *col);
 
-    bool operator==(const Edge &e) const
-    {
-        return (v0 == e.v0 && v1 == e.v1) ||
-            (v0 == e.v1 && v1 == e.v0);
-    }
-};
+// nullptr for the types that don't collide: meshes with meshes, boxes and capsules,
+// and distance fields and heightfields with anything but spheres
+CollisionTest getCollisionTest(ColliderType a, ColliderType b);
+// nullptr for the types spheres don't sweep against
+SweepTest getSweepTest(ColliderType type);
 
-class EdgeHash
-{
-public:
-    size_t operator()(const Edge &e) const
-    {
-        return hash<vec3>()(e.v0) ^ hash<vec3>()(e.v1);
-    }
-};
\ No newline at end of file
+void checkSphereMesh(PhysicsObject *sphere, ColliderSphere *sphereCol, PhysicsObject *mesh, ColliderMesh *meshCol);
+void checkSphereSphere(PhysicsObject *sphere1, ColliderSphere *sphereCol1, PhysicsObject *sphere2, ColliderSphere *sphereCol2);
+void checkSphereBox(PhysicsObject *sphere, ColliderSphere *sphereCol, PhysicsObject *box, ColliderBox *boxCol);
+void checkSphereCapsule(PhysicsObject *sphere, ColliderSphere *sphereCol, PhysicsObject *capsule, ColliderCapsule *capsuleCol);
+void checkBoxBox(PhysicsObject *box1, ColliderBox *boxCol1, PhysicsObject *box2, ColliderBox *boxCol2);
+void checkCapsuleBox(PhysicsObject *capsule, ColliderCapsule *capsuleCol, PhysicsObject *box, ColliderBox *boxCol);
+void checkCapsuleCapsule(PhysicsObject *capsule1, ColliderCapsule *capsuleCol1, PhysicsObject *capsule2, ColliderCapsule *capsuleCol2);
+void checkSphereConvex(PhysicsObject *sphere, ColliderSphere *sphereCol, PhysicsObject *convex, ColliderConvex *convexCol);
+void checkBoxConvex(PhysicsObject *box, ColliderBox *boxCol, PhysicsObject *convex, ColliderConvex *convexCol);
+void checkCapsuleConvex(PhysicsObject *capsule, ColliderCapsule *capsuleCol, PhysicsObject *convex, ColliderConvex *convexCol);
+void checkConvexConvex(PhysicsObject *convex1, ColliderConvex *convexCol1, PhysicsObject *convex2, ColliderConvex *convexCol2);
+void checkConvexMesh(PhysicsObject *convex, ColliderConvex *convexCol, PhysicsObject *mesh, ColliderMesh *meshCol);
+void checkSphereSDF(PhysicsObject *sphere, ColliderSphere *sphereCol, PhysicsObject *sdf, ColliderSDF *sdfCol);
+void checkSphereHeightfield(PhysicsObject *sphere, ColliderSphere *sphereCol, PhysicsObject *ground, ColliderHeightfield *groundCol);
+float sweepSphereMesh(PhysicsObject *sphere, ColliderSphere *sphereCol, vec3 start, PhysicsObject *mesh, ColliderMesh *meshCol);
+float sweepSphereSphere(PhysicsObject *sphere1, ColliderSphere *sphereCol1, vec3 start, PhysicsObject *sphere2, ColliderSphere *sphereCol2);
+float sweepSphereBox(PhysicsObject *sphere, ColliderSphere *sphereCol, vec3 start, PhysicsObject *box, ColliderBox *boxCol);
+float sweepSphereCapsule(PhysicsObject *sphere, ColliderSphere *sphereCol, vec3 start, PhysicsObject *capsule, ColliderCapsule *capsuleCol);
+float sweepSphereConvex(PhysicsObject *sphere, ColliderSphere *sphereCol, vec3 start, PhysicsObject *convex, ColliderConvex *convexCol);
+float sweepSphereSDF(PhysicsObject *sphere, ColliderSphere *sphereCol, vec3 start, PhysicsObject *sdf, ColliderSDF *sdfCol);
+float sweepSphereHeightfield(PhysicsObject *sphere, ColliderSphere *sphereCol, vec3 start, PhysicsObject *ground, ColliderHeightfield *groundCol);
+
+// Finds the point on triangle abc closest to p. Returns whether it lies inside the
+// face, on an edge (feature is the edge index, edge j runs from vertex j to j + 1)
+// or on a vertex (feature is the vertex index).
+ColGeom closestPointOnTriangle(const vec3 &p, const vec3 &a, const vec3 &b, const vec3 &c, vec3 &closest, int &feature);
@@ -0,0 +1,11 @@
+#include "ColliderBox.h"
+
+ColliderBox::ColliderBox(vec3 halfSize) :
+    Collider(COLLIDER_BOX, -halfSize, halfSize), halfSize(halfSize)
+{
+}
+
+float ColliderBox::getRadius(vec3 scale)
+{
+    return length(scale * halfSize);
+}
@@ -0,0 +1,24 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include "Collider.h"
+#include "ColliderSphere.h"
+#include "PhysicsObject.h"
+#include "BoundingBox.h"
+
+using namespace glm;
+
+// A box around the owner's position, turned by its orientation. It reaches
+// halfSize times the owner's scale along each of its axes.
+// Much cheaper than a ColliderMesh of a cube, which tests 12 faces, 18 edges and
+// 8 vertices for every contact.
+class ColliderBox : public Collider
+{
+public:
+    ColliderBox(vec3 halfSize);
+
+    virtual float getRadius(vec3 scale);
+
+    vec3 halfSize;
+};
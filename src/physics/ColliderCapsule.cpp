@@ -0,0 +1,24 @@
+#include "ColliderCapsule.h"
+
+#include <cassert>
+
+ColliderCapsule::ColliderCapsule(float radius, float halfHeight) :
+    Collider(COLLIDER_CAPSULE, vec3(-radius, -halfHeight - radius, -radius), vec3(radius, halfHeight + radius, radius)),
+    radius(radius), halfHeight(halfHeight)
+{
+}
+
+float ColliderCapsule::getRadius(vec3 scale)
+{
+    return (halfHeight + radius) * scale.x;
+}
+
+void ColliderCapsule::getSegment(PhysicsObject *owner, vec3 &p0, vec3 &p1, float &r)
+{
+    // the bounds are scaled along each axis, which only matches a uniform scale
+    assert(owner->scale.x == owner->scale.y && owner->scale.x == owner->scale.z);
+    vec3 axis = owner->orientation * vec3(0, halfHeight * owner->scale.x, 0);
+    p0 = owner->position - axis;
+    p1 = owner->position + axis;
+    r = radius * owner->scale.x;
+}
@@ -0,0 +1,28 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include "Collider.h"
+#include "ColliderSphere.h"
+#include "PhysicsObject.h"
+#include "BoundingBox.h"
+
+using namespace glm;
+
+// A sphere of radius swept along the owner's local y axis, from -halfHeight to
+// halfHeight around its position, turned by its orientation. A capsule stretched
+// along one axis isn't a capsule any more, so the owner's scale has to be the same
+// along every axis.
+class ColliderCapsule : public Collider
+{
+public:
+    ColliderCapsule(float radius, float halfHeight);
+
+    virtual float getRadius(vec3 scale);
+
+    // The world space segment through the middle and the radius around it
+    void getSegment(PhysicsObject *owner, vec3 &p0, vec3 &p1, float &r);
+
+    float radius;
+    float halfHeight;
+};
@@ -0,0 +1,17 @@
+#include "ColliderConvex.h"
+
+ColliderConvex::ColliderConvex(shared_ptr<Shape> mesh) :
+    Collider(COLLIDER_CONVEX, mesh->min, mesh->max)
+{
+    vector<vec3> points(mesh->getNumVertices());
+    for (size_t i = 0; i < points.size(); i++)
+    {
+        points[i] = mesh->getLocalVertex(i);
+    }
+    hull.build(points);
+}
+
+float ColliderConvex::getRadius(vec3 scale)
+{
+    return length(scale * (bbox.max - bbox.min)) / 2;
+}
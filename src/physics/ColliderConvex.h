@@ -0,0 +1,28 @@
+#pragma once
+
+#include <glm/glm.hpp>
+#include <memory>
+
+#include "Collider.h"
+#include "ColliderSphere.h"
+#include "ConvexHull.h"
+#include "PhysicsObject.h"
+#include "BoundingBox.h"
+#include "../Shape.h"
+
+using namespace glm;
+
+// The convex hull of a mesh, tested with GJK and EPA. The hull is kept in the
+// mesh's local space and found once, so a test only turns each search direction
+// into local space and the support point back out.
+// Unlike ColliderMesh it collides with everything, meshes included, so a prop that's
+// roughly convex can use one of these to stack on other props.
+class ColliderConvex : public Collider
+{
+public:
+    ColliderConvex(shared_ptr<Shape> mesh);
+
+    virtual float getRadius(vec3 scale);
+
+    ConvexHull hull;
+};
@@ -0,0 +1,175 @@
+#include "ColliderHeightfield.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+
+using namespace glm;
+using namespace std;
+
+// Height of triangle abc at (x, z), if it's over that point at all
+static bool heightOnTriangle(float x, float z, const vec3 &a, const vec3 &b, const vec3 &c, float &height)
+{
+    float det = (b.z - c.z) * (a.x - c.x) + (c.x - b.x) * (a.z - c.z);
+    if (det == 0)
+    {
+        // seen edge on from above
+        return false;
+    }
+    float u = ((b.z - c.z) * (x - c.x) + (c.x - b.x) * (z - c.z)) / det;
+    float v = ((c.z - a.z) * (x - c.x) + (a.x - c.x) * (z - c.z)) / det;
+    float w = 1 - u - v;
+    if (u < -1e-5f || v < -1e-5f || w < -1e-5f)
+    {
+        return false;
+    }
+    height = u * a.y + v * b.y + w * c.y;
+    return true;
+}
+
+ColliderHeightfield::ColliderHeightfield(const vector<float> &heights, int width, int depth, float cellSize) :
+    Collider(COLLIDER_HEIGHTFIELD, vec3(0), vec3(0)), heights(heights), width(width), depth(depth), cellSize(cellSize, cellSize)
+{
+    // faces are numbered by cell, and there has to be at least one
+    assert(width >= 2 && depth >= 2 && (int)heights.size() == width * depth);
+    origin = -vec2(width - 1, depth - 1) * this->cellSize / 2.0f;
+    measure();
+}
+
+ColliderHeightfield::ColliderHeightfield(shared_ptr<Shape> mesh, int resolution) :
+    Collider(COLLIDER_HEIGHTFIELD, mesh->min, mesh->max)
+{
+    vec3 extent = mesh->max - mesh->min;
+    float step = std::max(extent.x, extent.z) / resolution;
+    // a mesh that's flat along x or z still gets a row of cells
+    width = std::max(2, (int)ceil(extent.x / step) + 1);
+    depth = std::max(2, (int)ceil(extent.z / step) + 1);
+    // stretched a little along the shorter side so the grid ends on the mesh's edge
+    cellSize.x = extent.x > 0 ? extent.x / (width - 1) : step;
+    cellSize.y = extent.z > 0 ? extent.z / (depth - 1) : step;
+    origin = vec2(mesh->min.x, mesh->min.z);
+
+    // the heights are found from the triangles over each point
+    if (mesh->bvh.empty())
+    {
+        mesh->findEdges();
+    }
+    mat4 I(1.f);
+    vector<int> faces;
+    heights.resize(width * depth);
+    for (int z = 0; z < depth; z++)
+    {
+        for (int x = 0; x < width; x++)
+        {
+            // rounding can put the last row and column just past the mesh
+            float px = std::min(origin.x + x * cellSize.x, mesh->max.x);
+            float pz = std::min(origin.y + z * cellSize.y, mesh->max.z);
+            faces.clear();
+            mesh->bvh.query(vec3(px, mesh->min.y, pz), vec3(px, mesh->max.y, pz), faces);
+
+            float height = mesh->min.y;
+            for (int i : faces)
+            {
+                vec3 v[3];
+                mesh->getFace(i, I, v);
+                float h;
+                if (heightOnTriangle(px, pz, v[0], v[1], v[2], h))
+                {
+                    height = std::max(height, h);
+                }
+            }
+            heights[z * width + x] = height;
+        }
+    }
+    measure();
+}
+
+void ColliderHeightfield::measure()
+{
+    float low = heights.empty() ? 0 : *min_element(heights.begin(), heights.end());
+    float high = heights.empty() ? 0 : *max_element(heights.begin(), heights.end());
+    vec2 end = origin + vec2(width - 1, depth - 1) * cellSize;
+    bbox = BoundingBox(vec3(origin.x, low, origin.y), vec3(end.x, high, end.y));
+}
+
+float ColliderHeightfield::getRadius(vec3 scale)
+{
+    return length(scale * (bbox.max - bbox.min)) / 2;
+}
+
+void ColliderHeightfield::query(const vec3 &min, const vec3 &max, vector<int> &faces) const
+{
+    // the cells the box's corners are in, kept on the grid
+    int x0 = (int)std::max(0.0f, floor((min.x - origin.x) / cellSize.x));
+    int z0 = (int)std::max(0.0f, floor((min.z - origin.y) / cellSize.y));
+    int x1 = (int)std::min((float)width - 2, floor((max.x - origin.x) / cellSize.x));
+    int z1 = (int)std::min((float)depth - 2, floor((max.z - origin.y) / cellSize.y));
+    for (int z = z0; z <= z1; z++)
+    {
+        for (int x = x0; x <= x1; x++)
+        {
+            const float *row = &heights[z * width + x];
+            float h[4] = {row[0], row[1], row[width], row[width + 1]};
+            if (*min_element(h, h + 4) > max.y || *max_element(h, h + 4) < min.y)
+            {
+                continue;
+            }
+            int face = (z * (width - 1) + x) * 2;
+            faces.push_back(face);
+            faces.push_back(face + 1);
+        }
+    }
+}
+
+unsigned int ColliderHeightfield::getFaceVertexId(int i, int j) const
+{
+    int cell = i / 2;
+    unsigned int a = (cell / (width - 1)) * width + cell % (width - 1);
+    unsigned int b = a + 1;
+    unsigned int c = a + width;
+    unsigned int d = a + width + 1;
+    // counterclockwise from above, so the faces point up
+    unsigned int faces[2][3] = {{a, c, d}, {a, d, b}};
+    return faces[i % 2][j];
+}
+
+unsigned int ColliderHeightfield::getFaceEdge(int i, int j) const
+{
+    unsigned int p = getFaceVertexId(i, j);
+    unsigned int q = getFaceVertexId(i, (j + 1) % 3);
+    unsigned int low = std::min(p, q);
+    unsigned int step = std::max(p, q) - low;
+    return low * 3 + (step == 1 ? 0 : step == (unsigned int)width ? 1 : 2);
+}
+
+void ColliderHeightfield::getEdgeVertexIds(unsigned int edge, unsigned int ids[2]) const
+{
+    unsigned int steps[3] = {1, (unsigned int)width, (unsigned int)width + 1};
+    ids[0] = edge / 3;
+    ids[1] = ids[0] + steps[edge % 3];
+}
+
+vec3 ColliderHeightfield::getVertex(unsigned int id) const
+{
+    int x = id % width;
+    int z = id / width;
+    return vec3(origin.x + x * cellSize.x, heights[id], origin.y + z * cellSize.y);
+}
+
+void ColliderHeightfield::getFace(int i, const mat4 &M, vec3 v[3]) const
+{
+    for (int j = 0; j < 3; j++)
+    {
+        v[j] = vec3(M * vec4(getVertex(getFaceVertexId(i, j)), 1));
+    }
+}
+
+int ColliderHeightfield::getWidth() const
+{
+    return width;
+}
+
+int ColliderHeightfield::getDepth() const
+{
+    return depth;
+}
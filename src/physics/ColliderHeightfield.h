@@ -0,0 +1,58 @@
+#pragma once
+
+#include <glm/glm.hpp>
+#include <memory>
+#include <vector>
+
+#include "Collider.h"
+#include "ColliderSphere.h"
+#include "PhysicsObject.h"
+#include "BoundingBox.h"
+#include "../Shape.h"
+
+using namespace glm;
+
+// Ground as a regular grid of heights along local y, for big terrain that would
+// otherwise be a mesh with thousands of faces. The cells under a sphere are found
+// by dividing its position by the cell size, so a sphere up to a cell across only
+// ever tests the triangles of 1 to 4 cells.
+// Only spheres collide with it, and like a mesh only its top is solid.
+class ColliderHeightfield : public Collider
+{
+public:
+    // heights has width * depth samples, x first, cellSize apart and centered on the origin.
+    // width and depth have to be at least 2.
+    ColliderHeightfield(const vector<float> &heights, int width, int depth, float cellSize);
+    // Samples the top of mesh on a grid with resolution cells along its longest side
+    // in x and z, lined up with the mesh so the two can share a transform. The grid
+    // covers exactly the mesh's bounds, so along the shorter side the cells can be a
+    // little longer. Points the mesh doesn't cover get its lowest height.
+    ColliderHeightfield(shared_ptr<Shape> mesh, int resolution = 64);
+
+    virtual float getRadius(vec3 scale);
+
+    // Appends the triangles of the cells under the box, in local space, skipping
+    // cells entirely above or below it
+    void query(const vec3 &min, const vec3 &max, vector<int> &faces) const;
+
+    // Cell (x, z) is split along its diagonal into faces (z * (width - 1) + x) * 2
+    // and the one after. Grid point (x, z) is vertex z * width + x, and has the 3
+    // edges going to +x, +z and the diagonal, numbered from 3 times its vertex.
+    void getFace(int i, const mat4 &M, vec3 v[3]) const;
+    unsigned int getFaceEdge(int i, int j) const; // edge j of face i runs from its vertex j to j + 1
+    unsigned int getFaceVertexId(int i, int j) const;
+    void getEdgeVertexIds(unsigned int edge, unsigned int ids[2]) const;
+
+    int getWidth() const;
+    int getDepth() const;
+
+private:
+    void measure();
+    vec3 getVertex(unsigned int id) const;
+
+    vector<float> heights;
+    int width;
+    int depth;
+    vec2 cellSize; // along local x and z
+    vec2 origin; // local x and z of the first sample
+};
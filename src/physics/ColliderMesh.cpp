@@ -4,18 +4,14 @@ using namespace glm;
 using namespace std;
 
 ColliderMesh::ColliderMesh(shared_ptr<Shape> mesh) :
-    Collider(mesh->min, mesh->max), mesh(mesh)
+    Collider(COLLIDER_MESH, mesh->min, mesh->max), mesh(mesh)
 {
-}
-
-void ColliderMesh::checkCollision(PhysicsObject *owner, PhysicsObject *obj, Collider *col)
-{
-    col->checkCollision(obj, owner, this);
-}
-
-void ColliderMesh::checkCollision(PhysicsObject *owner, PhysicsObject *obj, ColliderSphere *col)
-{
-    checkSphereMesh(obj, col, owner, this);
+    // the triangle hierarchy and edge list are needed for collision
+    if (mesh->bvh.empty())
+    {
+        mesh->findEdges();
+    }
+    triangles.build(*mesh);
 }
 
 float ColliderMesh::getRadius(vec3 scale)
@@ -7,6 +7,7 @@
 #include "ColliderSphere.h"
 #include "PhysicsObject.h"
 #include "BoundingBox.h"
+#include "SphereTriangleKernel.h"
 #include "../Shape.h"
 
 class ColliderMesh : public Collider
@@ -14,9 +15,8 @@ class ColliderMesh : public Collider
 public:
     ColliderMesh(shared_ptr<Shape> mesh);
 
-    virtual void checkCollision(PhysicsObject *owner, PhysicsObject *obj, Collider *col);
-    virtual void checkCollision(PhysicsObject *owner, PhysicsObject *obj, ColliderSphere *col);
     virtual float getRadius(vec3 scale);
 
     shared_ptr<Shape> mesh;
+    TriangleSoA triangles; // mesh triangles in BVH order for the SIMD sphere test
 };
\ No newline at end of file
@@ -0,0 +1,238 @@
+#include "ColliderSDF.h"
+
+#define GLM_ENABLE_EXPERIMENTAL
+#include <glm/gtx/norm.hpp>
+
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+using namespace glm;
+using namespace std;
+
+// Cells of grid kept around the mesh's bounds
+#define SDF_PADDING 2
+
+// What a cache file starts with, followed by the distances
+struct SDFHeader
+{
+    char magic[4];
+    int resolution;
+    int numFaces;
+    int numVertices;
+    unsigned long long meshHash;
+    vec3 min;
+    vec3 max;
+    ivec3 size;
+    vec3 origin;
+    float cellSize;
+};
+
+// FNV-1a over the mesh's positions and indices, so a mesh that was edited but kept
+// its counts and bounds doesn't load a grid baked from the old one
+static unsigned long long hashMesh(Shape &mesh)
+{
+    unsigned long long hash = 14695981039346656037ULL;
+    auto add = [&hash](const void *data, size_t size) {
+        const unsigned char *bytes = (const unsigned char *)data;
+        for (size_t i = 0; i < size; i++)
+        {
+            hash = (hash ^ bytes[i]) * 1099511628211ULL;
+        }
+    };
+    for (int i = 0; i < mesh.getNumVertices(); i++)
+    {
+        vec3 v = mesh.getLocalVertex(i);
+        add(&v, sizeof(v));
+    }
+    for (int i = 0; i < mesh.getNumFaces(); i++)
+    {
+        for (int j = 0; j < 3; j++)
+        {
+            unsigned int index = mesh.getFaceIndex(i, j);
+            add(&index, sizeof(index));
+        }
+    }
+    return hash;
+}
+
+ColliderSDF::ColliderSDF(shared_ptr<Shape> mesh, int resolution, const string &cacheFile, shared_ptr<WorkerPool> pool) :
+    Collider(COLLIDER_SDF, mesh->min, mesh->max), mesh(mesh), resolution(resolution)
+{
+    vec3 extent = mesh->max - mesh->min;
+    cellSize = std::max(extent.x, std::max(extent.y, extent.z)) / resolution;
+    origin = mesh->min - vec3(cellSize * SDF_PADDING);
+    size = ivec3(ceil(extent / cellSize)) + 1 + 2 * SDF_PADDING;
+
+    if (!cacheFile.empty() && load(cacheFile))
+    {
+        return;
+    }
+    // the bake finds the nearest triangles with the mesh's hierarchy
+    if (mesh->bvh.empty())
+    {
+        mesh->findEdges();
+    }
+    bake(pool.get());
+    if (!cacheFile.empty())
+    {
+        save(cacheFile);
+    }
+}
+
+float ColliderSDF::getRadius(vec3 scale)
+{
+    return length(scale * (bbox.max - bbox.min)) / 2;
+}
+
+float ColliderSDF::at(int x, int y, int z) const
+{
+    return distances[(z * size.y + y) * size.x + x];
+}
+
+float ColliderSDF::getDistance(const vec3 &p, vec3 &gradient) const
+{
+    // position in cells, kept inside the grid
+    vec3 g = (p - origin) / cellSize;
+    vec3 inside = clamp(g, vec3(0), vec3(size - 1));
+    ivec3 c = min(ivec3(inside), size - 2);
+    vec3 f = inside - vec3(c);
+
+    // blend the corners of the cell along x, then y, then z
+    float d00 = mix(at(c.x, c.y, c.z), at(c.x + 1, c.y, c.z), f.x);
+    float d10 = mix(at(c.x, c.y + 1, c.z), at(c.x + 1, c.y + 1, c.z), f.x);
+    float d01 = mix(at(c.x, c.y, c.z + 1), at(c.x + 1, c.y, c.z + 1), f.x);
+    float d11 = mix(at(c.x, c.y + 1, c.z + 1), at(c.x + 1, c.y + 1, c.z + 1), f.x);
+    float d0 = mix(d00, d10, f.y);
+    float d1 = mix(d01, d11, f.y);
+
+    // and the slope of the same blend
+    float dx00 = at(c.x + 1, c.y, c.z) - at(c.x, c.y, c.z);
+    float dx10 = at(c.x + 1, c.y + 1, c.z) - at(c.x, c.y + 1, c.z);
+    float dx01 = at(c.x + 1, c.y, c.z + 1) - at(c.x, c.y, c.z + 1);
+    float dx11 = at(c.x + 1, c.y + 1, c.z + 1) - at(c.x, c.y + 1, c.z + 1);
+    gradient.x = mix(mix(dx00, dx10, f.y), mix(dx01, dx11, f.y), f.z);
+    gradient.y = mix(d10 - d00, d11 - d01, f.z);
+    gradient.z = d1 - d0;
+    gradient /= cellSize;
+
+    return mix(d0, d1, f.z) + distance(g, inside) * cellSize;
+}
+
+void ColliderSDF::bake(WorkerPool *pool)
+{
+    distances.resize(size.x * size.y * size.z);
+    if (pool != nullptr)
+    {
+        pool->run(size.z, [this](int z) { bakeSlice(z); });
+    }
+    else
+    {
+        for (int z = 0; z < size.z; z++)
+        {
+            bakeSlice(z);
+        }
+    }
+}
+
+// Every grid point's distance to the nearest triangle. Whether it's inside is
+// decided by the normals of the triangles that share the nearest point, weighted
+// by the angle each one has there, which points out of a closed mesh even at its
+// edges and corners.
+// http://www2.imm.dtu.dk/pubdb/edoc/imm1289.pdf
+void ColliderSDF::bakeSlice(int z)
+{
+    Shape *shape = mesh.get();
+    mat4 I(1.f);
+    float tolerance = cellSize * 1e-4f;
+    for (int y = 0; y < size.y; y++)
+    {
+        for (int x = 0; x < size.x; x++)
+        {
+            vec3 p = origin + vec3(x, y, z) * cellSize;
+            float best = INFINITY;
+            vec3 bestPoint = p;
+            vec3 normal = vec3(0);
+            shape->bvh.queryNearest(p, tolerance, [&](int i)
+            {
+                vec3 v[3];
+                shape->getFace(i, I, v);
+                vec3 closest;
+                int feature;
+                ColGeom geom = closestPointOnTriangle(p, v[0], v[1], v[2], closest, feature);
+                float d = distance(p, closest);
+                if (d > best + tolerance)
+                {
+                    return d;
+                }
+                if (d < best - tolerance)
+                {
+                    best = d;
+                    bestPoint = closest;
+                    normal = vec3(0);
+                }
+
+                vec3 faceNormal = cross(v[1] - v[0], v[2] - v[0]);
+                if (faceNormal != vec3(0))
+                {
+                    float weight = 1;
+                    if (geom == VERT)
+                    {
+                        vec3 e1 = normalize(v[(feature + 1) % 3] - v[feature]);
+                        vec3 e2 = normalize(v[(feature + 2) % 3] - v[feature]);
+                        weight = acos(clamp(dot(e1, e2), -1.0f, 1.0f));
+                    }
+                    normal += normalize(faceNormal) * weight;
+                }
+                return d;
+            });
+            distances[(z * size.y + y) * size.x + x] = dot(p - bestPoint, normal) < 0 ? -best : best;
+        }
+    }
+}
+
+bool ColliderSDF::load(const string &file)
+{
+    ifstream in(file, ios::binary);
+    SDFHeader header;
+    if (!in.read((char *)&header, sizeof(header)))
+    {
+        return false;
+    }
+    // only use it if it was baked from the same mesh the same way
+    if (memcmp(header.magic, "SDF2", 4) != 0 || header.resolution != resolution ||
+        header.numFaces != mesh->getNumFaces() || header.numVertices != mesh->getNumVertices() ||
+        header.min != mesh->min || header.max != mesh->max || header.meshHash != hashMesh(*mesh))
+    {
+        return false;
+    }
+    size = header.size;
+    origin = header.origin;
+    cellSize = header.cellSize;
+    distances.resize(size.x * size.y * size.z);
+    return (bool)in.read((char *)distances.data(), distances.size() * sizeof(float));
+}
+
+void ColliderSDF::save(const string &file) const
+{
+    SDFHeader header;
+    memcpy(header.magic, "SDF2", 4);
+    header.resolution = resolution;
+    header.numFaces = mesh->getNumFaces();
+    header.numVertices = mesh->getNumVertices();
+    header.meshHash = hashMesh(*mesh);
+    header.min = mesh->min;
+    header.max = mesh->max;
+    header.size = size;
+    header.origin = origin;
+    header.cellSize = cellSize;
+
+    ofstream out(file, ios::binary);
+    out.write((const char *)&header, sizeof(header));
+    out.write((const char *)distances.data(), distances.size() * sizeof(float));
+    if (!out)
+    {
+        cerr << "could not write " << file << endl;
+    }
+}
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <glm/glm.hpp>
+#include <memory>
+#include <string>
+
+#include "Collider.h"
+#include "ColliderSphere.h"
+#include "PhysicsObject.h"
+#include "BoundingBox.h"
+#include "WorkerPool.h"
+#include "../Shape.h"
+
+using namespace glm;
+
+// A static mesh baked into a grid of signed distances in its local space, negative
+// inside. Testing a sphere against it is one trilinear lookup and its gradient
+// instead of a walk over the triangles near the sphere, which pays off for big
+// level meshes that lots of spheres rest on.
+// Only spheres collide with it. Corners come out rounded off by about a cell, and
+// inside is decided by which way the nearest triangles face, so the mesh should be
+// closed or only ever touched from the front.
+class ColliderSDF : public Collider
+{
+public:
+    // resolution is the number of cells along the longest side of the mesh. The bake
+    // is split over pool when there is one. When cacheFile is given the grid is read
+    // from it if it was baked from the same mesh at the same resolution, and is
+    // otherwise baked and written to it.
+    ColliderSDF(shared_ptr<Shape> mesh, int resolution = 64, const string &cacheFile = "", shared_ptr<WorkerPool> pool = nullptr);
+
+    virtual float getRadius(vec3 scale);
+
+    // Signed distance from a point in mesh space to the surface, and the direction
+    // it grows fastest in. Outside the grid it's the distance to the grid's edge plus
+    // the distance there.
+    float getDistance(const vec3 &p, vec3 &gradient) const;
+
+    shared_ptr<Shape> mesh;
+
+private:
+    void bake(WorkerPool *pool);
+    void bakeSlice(int z);
+    bool load(const string &file);
+    void save(const string &file) const;
+    float at(int x, int y, int z) const;
+
+    int resolution;
+    ivec3 size; // grid points along each axis
+    vec3 origin; // mesh space position of grid point (0, 0, 0)
+    float cellSize;
+    vector<float> distances; // x first, then y, then z
+};
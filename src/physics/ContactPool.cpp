@@ -0,0 +1,385 @@
+#include "ContactPool.h"
+
+#include <algorithm>
+#include <cmath>
+#include <functional>
+
+#include "PhysicsObject.h"
+#include "PhysicsWorld.h"
+
+// Most contacts reduceContacts keeps with each other object
+#define MANIFOLD_SIZE 4
+
+void ContactPool::clear()
+{
+    // swapping keeps the storage of both
+    swap(contacts, cachedContacts);
+    swap(impulses, cachedImpulses);
+    swap(starts, cachedStarts);
+    swap(ends, cachedEnds);
+    numCached = numGrouped;
+
+    records.clear();
+    numGrouped = 0;
+}
+
+void ContactPool::add(int body, const Collision &collision)
+{
+    records.push_back(ContactRecord());
+    records.back().body = body;
+    records.back().collision = collision;
+}
+
+void ContactPool::add(const ContactRecord &record)
+{
+    records.push_back(record);
+}
+
+void ContactPool::group(int numBodies)
+{
+    // counting sort on the body
+    starts.assign(numBodies + 1, 0);
+    for (const ContactRecord &record : records)
+    {
+        starts[record.body + 1]++;
+    }
+    for (int i = 0; i < numBodies; i++)
+    {
+        starts[i + 1] += starts[i];
+    }
+    ends.assign(starts.begin(), starts.end() - 1);
+    contacts.resize(records.size());
+    for (const ContactRecord &record : records)
+    {
+        contacts[ends[record.body]++] = record.collision;
+    }
+    impulses.assign(records.size(), ContactImpulse());
+    numGrouped = numBodies;
+}
+
+int ContactPool::size() const
+{
+    return (int)records.size();
+}
+
+const ContactRecord &ContactPool::getRecord(int i) const
+{
+    return records[i];
+}
+
+bool ContactPool::hasContact(int body, const PhysicsObject *other) const
+{
+    for (int i = begin(body); i < end(body); i++)
+    {
+        if (contacts[i].other == other)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+float ContactPool::getCachedImpulse(int body, const Collision &collision) const
+{
+    if (body >= numCached)
+    {
+        return 0;
+    }
+    for (int i = cachedStarts[body]; i < cachedEnds[body]; i++)
+    {
+        const Collision &cached = cachedContacts[i];
+        if (cached.other == collision.other && cached.geom == collision.geom && cached.feature == collision.feature)
+        {
+            return cachedImpulses[i].impulse;
+        }
+    }
+    return 0;
+}
+
+// Moves the last body's range into body and forgets the last one
+static void moveRange(vector<int> &starts, vector<int> &ends, int &num, int body, int last)
+{
+    if (body < num)
+    {
+        starts[body] = last < num ? starts[last] : 0;
+        ends[body] = last < num ? ends[last] : 0;
+    }
+    num = (std::min)(num, last);
+}
+
+void ContactPool::removeBody(int body, int last)
+{
+    moveRange(starts, ends, numGrouped, body, last);
+    moveRange(cachedStarts, cachedEnds, numCached, body, last);
+}
+
+static thread_local vector<ContactRecord> *contactBuffer = nullptr;
+
+void addCollision(PhysicsObject *obj, const Collision &collision)
+{
+    if (contactBuffer != nullptr)
+    {
+        contactBuffer->push_back(ContactRecord());
+        contactBuffer->back().body = obj->getBody();
+        contactBuffer->back().collision = collision;
+    }
+    else
+    {
+        World.contacts.add(obj->getBody(), collision);
+    }
+}
+
+void setContactBuffer(vector<ContactRecord> *buffer)
+{
+    contactBuffer = buffer;
+}
+
+// The planes of the faces with one other object are planes[begin] to planes[end - 1]
+struct PlaneRun
+{
+    PhysicsObject *other;
+    int begin;
+    int end;
+};
+
+int filterEdgeContacts(Collision *contacts, int count)
+{
+    // Scratch buffers, kept between calls so they don't have to be reallocated
+    static thread_local vector<int> faces;
+    static thread_local vector<int> planes; // the furthest out face with each normal
+    static thread_local vector<PlaneRun> runs;
+    static thread_local vector<char> dropped;
+
+    faces.clear();
+    bool edges = false;
+    for (int i = 0; i < count; i++)
+    {
+        const Collision &c = contacts[i];
+        if (c.geom == FACE && !isnan(c.normal.x) && !isnan(c.normal.y) && !isnan(c.normal.z))
+        {
+            faces.push_back(i);
+        }
+        else if (c.geom == EDGE || c.geom == VERT)
+        {
+            edges = true;
+        }
+    }
+    if (faces.empty() || !edges)
+    {
+        return count;
+    }
+
+    // Sort the faces by object and normal, furthest out first. Only the furthest
+    // face of each plane can drop anything the others would, so a mesh with lots
+    // of coplanar faces is tested as one plane.
+    sort(faces.begin(), faces.end(), [contacts](int a, int b) {
+        const Collision &ca = contacts[a];
+        const Collision &cb = contacts[b];
+        if (ca.other != cb.other) return less<PhysicsObject *>()(ca.other, cb.other);
+        if (ca.normal.x != cb.normal.x) return ca.normal.x < cb.normal.x;
+        if (ca.normal.y != cb.normal.y) return ca.normal.y < cb.normal.y;
+        if (ca.normal.z != cb.normal.z) return ca.normal.z < cb.normal.z;
+        return dot(ca.v[0], ca.normal) > dot(cb.v[0], cb.normal);
+    });
+    planes.clear();
+    runs.clear();
+    for (int i = 0; i < (int)faces.size(); i++)
+    {
+        const Collision &c = contacts[faces[i]];
+        if (i > 0)
+        {
+            const Collision &prev = contacts[faces[i - 1]];
+            if (prev.other == c.other && prev.normal == c.normal)
+            {
+                continue;
+            }
+        }
+        if (runs.empty() || runs.back().other != c.other)
+        {
+            runs.push_back(PlaneRun{c.other, (int)planes.size(), (int)planes.size()});
+        }
+        planes.push_back(faces[i]);
+        runs.back().end++;
+    }
+
+    // Each edge or vertex only has to be tested against the planes of other objects
+    dropped.assign(count, 0);
+    for (int j = 0; j < count; j++)
+    {
+        const Collision &c = contacts[j];
+        if (c.geom != EDGE && c.geom != VERT)
+        {
+            continue;
+        }
+        for (int r = 0; r < (int)runs.size() && !dropped[j]; r++)
+        {
+            if (runs[r].other == c.other)
+            {
+                continue;
+            }
+            for (int k = runs[r].begin; k < runs[r].end; k++)
+            {
+                const Collision &face = contacts[planes[k]];
+                if (dot(c.pos - face.v[0], face.normal) < 0.1f)
+                {
+                    dropped[j] = 1;
+                    break;
+                }
+            }
+        }
+    }
+
+    int kept = 0;
+    for (int i = 0; i < count; i++)
+    {
+        if (!dropped[i])
+        {
+            if (kept != i)
+            {
+                contacts[kept] = contacts[i];
+            }
+            kept++;
+        }
+    }
+    return kept;
+}
+
+// Picks which of the contacts in order[0] to order[count - 1] to keep
+static void reduceManifold(const Collision *contacts, const int *order, int count, vector<char> &kept)
+{
+    // the deepest
+    int a = order[0];
+    for (int i = 1; i < count; i++)
+    {
+        if (contacts[order[i]].penetration > contacts[a].penetration)
+        {
+            a = order[i];
+        }
+    }
+    kept[a] = 1;
+
+    // the furthest from it
+    int b = -1;
+    float best = 0;
+    for (int i = 0; i < count; i++)
+    {
+        float d = distance2(contacts[order[i]].pos, contacts[a].pos);
+        if (d > best)
+        {
+            best = d;
+            b = order[i];
+        }
+    }
+    if (b == -1)
+    {
+        return;
+    }
+    kept[b] = 1;
+
+    // the furthest from the line through them
+    vec3 pa = contacts[a].pos;
+    vec3 ab = contacts[b].pos - pa;
+    int c = -1;
+    best = 0;
+    for (int i = 0; i < count; i++)
+    {
+        float d = length2(cross(ab, contacts[order[i]].pos - pa));
+        if (d > best)
+        {
+            best = d;
+            c = order[i];
+        }
+    }
+    if (c == -1)
+    {
+        return;
+    }
+    kept[c] = 1;
+
+    // the furthest outside the triangle they make
+    vec3 pb = contacts[b].pos;
+    vec3 pc = contacts[c].pos;
+    vec3 n = cross(ab, pc - pa);
+    int d = -1;
+    best = 0;
+    for (int i = 0; i < count; i++)
+    {
+        vec3 p = contacts[order[i]].pos;
+        float outside = -(std::min)((std::min)(dot(cross(pb - pa, p - pa), n), dot(cross(pc - pb, p - pb), n)),
+            dot(cross(pa - pc, p - pc), n));
+        if (outside > best)
+        {
+            best = outside;
+            d = order[i];
+        }
+    }
+    if (d != -1)
+    {
+        kept[d] = 1;
+    }
+}
+
+int reduceContacts(Collision *contacts, int count)
+{
+    // Scratch buffers, kept between calls so they don't have to be reallocated
+    static thread_local vector<int> order;
+    static thread_local vector<char> kept;
+
+    if (count <= MANIFOLD_SIZE)
+    {
+        return count;
+    }
+
+    // group the contacts by object, keeping them in order for each one
+    order.resize(count);
+    for (int i = 0; i < count; i++)
+    {
+        order[i] = i;
+    }
+    sort(order.begin(), order.end(), [contacts](int a, int b) {
+        if (contacts[a].other != contacts[b].other) return less<PhysicsObject *>()(contacts[a].other, contacts[b].other);
+        return a < b;
+    });
+
+    kept.assign(count, 0);
+    bool reduced = false;
+    for (int start = 0; start < count;)
+    {
+        int stop = start + 1;
+        while (stop < count && contacts[order[stop]].other == contacts[order[start]].other)
+        {
+            stop++;
+        }
+        if (stop - start > MANIFOLD_SIZE)
+        {
+            reduceManifold(contacts, &order[start], stop - start, kept);
+            reduced = true;
+        }
+        else
+        {
+            for (int i = start; i < stop; i++)
+            {
+                kept[order[i]] = 1;
+            }
+        }
+        start = stop;
+    }
+    if (!reduced)
+    {
+        return count;
+    }
+
+    int numKept = 0;
+    for (int i = 0; i < count; i++)
+    {
+        if (kept[i])
+        {
+            if (numKept != i)
+            {
+                contacts[numKept] = contacts[i];
+            }
+            numKept++;
+        }
+    }
+    return numKept;
+}
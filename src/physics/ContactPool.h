@@ -0,0 +1,110 @@
+#pragma once
+
+#include <vector>
+
+#include "Collider.h"
+
+using namespace std;
+
+// A Collision for a body, as the collider tests report it
+struct ContactRecord
+{
+    int body;
+    Collision collision;
+};
+
+// What the solver keeps for each contact
+struct ContactImpulse
+{
+    float impulse; // pushing the objects apart along the normal, added up over the solver iterations
+    float bounce; // how fast the contact should be separating after the step
+    float mass; // 1 / both inverse masses, 0 if this body doesn't solve the contact
+    float otherInvMass; // 0 if the other object can't be pushed
+};
+
+// Every contact found in a step. The tests add contacts in any order, then group
+// sorts them by body so each body's contacts are one range of indices. The indices
+// stay put until the pool is cleared for the next step, and the storage is kept
+// between steps, so once it's grown to fit a busy step nothing is allocated.
+//
+// Clearing keeps the last step's contacts and the impulses the solver ended up
+// with as a cache. A contact that's still there the next step, touching the same
+// feature of the same object, starts from its old impulse, so resting contacts
+// don't have to build their impulse up from nothing every step.
+class ContactPool
+{
+public:
+    void clear();
+    void add(int body, const Collision &collision);
+    void add(const ContactRecord &record);
+    // Sorts the contacts added since clear by body, keeping them in the order
+    // they were added for each body
+    void group(int numBodies);
+
+    int size() const; // contacts added since clear
+    const ContactRecord &getRecord(int i) const; // in the order they were added
+
+    // A body's contacts after group are begin(body) to end(body) - 1
+    int begin(int body) const
+    {
+        return body < numGrouped ? starts[body] : 0;
+    }
+    int end(int body) const
+    {
+        return body < numGrouped ? ends[body] : 0;
+    }
+    // For dropping contacts off the end of a body's range once they're filtered out
+    void setEnd(int body, int end)
+    {
+        ends[body] = end;
+    }
+    Collision &operator[](int i)
+    {
+        return contacts[i];
+    }
+    ContactImpulse &getImpulse(int i)
+    {
+        return impulses[i];
+    }
+
+    // Whether any of the body's contacts are with other
+    bool hasContact(int body, const PhysicsObject *other) const;
+    // The impulse the body's matching contact ended the last step with, 0 if it's new
+    float getCachedImpulse(int body, const Collision &collision) const;
+    // Keeps the ranges in step with PhysicsWorld::removeBody moving the last body into body
+    void removeBody(int body, int last);
+
+private:
+    vector<ContactRecord> records;
+    vector<Collision> contacts; // grouped by body
+    vector<ContactImpulse> impulses; // by contact
+    vector<int> starts;
+    vector<int> ends;
+    int numGrouped = 0; // bodies with ranges
+
+    // the last step's contacts
+    vector<Collision> cachedContacts;
+    vector<ContactImpulse> cachedImpulses;
+    vector<int> cachedStarts;
+    vector<int> cachedEnds;
+    int numCached = 0;
+};
+
+// The collider tests report their results through addCollision. Normally the
+// collision goes straight into World.contacts, but a thread can send its
+// collisions to a buffer of its own instead so that tests can run in parallel
+// (see NarrowPhase).
+void addCollision(PhysicsObject *obj, const Collision &collision);
+void setContactBuffer(vector<ContactRecord> *buffer); // for the calling thread, nullptr to stop
+
+// Drops the edge and vertex contacts that lie under, or less than 0.1 above, the
+// plane of a face contact with a different object, so objects slide over the
+// seams between them instead of bumping into them. The contacts that are left
+// are moved to the front in the same order, and the number left is returned.
+int filterEdgeContacts(Collision *contacts, int count);
+
+// Cuts the contacts with each other object down to a manifold of at most four:
+// the deepest one, then the ones that spread out the area they cover the most.
+// A body lying across lots of small faces then gets the same number of impulses
+// as one lying on a single big face. Works like filterEdgeContacts.
+int reduceContacts(Collision *contacts, int count);
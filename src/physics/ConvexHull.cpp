@@ -0,0 +1,365 @@
+#include "ConvexHull.h"
+
+#define GLM_ENABLE_EXPERIMENTAL
+#include <glm/gtx/norm.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <unordered_set>
+
+// Hulls with fewer vertices than this are searched by checking every vertex
+#define HULL_WALK_MIN_VERTICES 32
+
+struct HullFace
+{
+    int v[3];
+    vec3 normal;
+    float offset;
+    vector<int> outside; // points in front of the face
+    bool alive;
+};
+
+static HullFace makeFace(const vector<vec3> &points, int a, int b, int c)
+{
+    HullFace face;
+    face.v[0] = a;
+    face.v[1] = b;
+    face.v[2] = c;
+    vec3 n = cross(points[b] - points[a], points[c] - points[a]);
+    float len = length(n);
+    face.normal = len > 0 ? n / len : vec3(0);
+    face.offset = dot(face.normal, points[a]);
+    face.alive = true;
+    return face;
+}
+
+static float distanceTo(const HullFace &face, const vec3 &p)
+{
+    return dot(face.normal, p) - face.offset;
+}
+
+static long long edgeKey(int a, int b)
+{
+    return ((long long)a << 32) | (unsigned int)b;
+}
+
+ConvexHull::ConvexHull()
+{
+}
+
+// http://media.steampowered.com/apps/valve/2014/DirkGregorius_ImplementingQuickHull.pdf
+void ConvexHull::build(const vector<vec3> &points)
+{
+    vertices.clear();
+    faces.clear();
+    normals.clear();
+    neighborStart.clear();
+    neighbors.clear();
+    int n = (int)points.size();
+    if (n == 0)
+    {
+        return;
+    }
+
+    // the points furthest apart of the ones with the lowest and highest x, y and z
+    int extremes[6] = {0, 0, 0, 0, 0, 0};
+    for (int i = 1; i < n; i++)
+    {
+        for (int k = 0; k < 3; k++)
+        {
+            if (points[i][k] < points[extremes[k * 2]][k])
+            {
+                extremes[k * 2] = i;
+            }
+            if (points[i][k] > points[extremes[k * 2 + 1]][k])
+            {
+                extremes[k * 2 + 1] = i;
+            }
+        }
+    }
+    vec3 size = points[extremes[1]] - points[extremes[0]];
+    size = max(size, points[extremes[3]] - points[extremes[2]]);
+    size = max(size, points[extremes[5]] - points[extremes[4]]);
+    float eps = 1e-5f * (fabs(size.x) + fabs(size.y) + fabs(size.z));
+
+    int a = 0;
+    int b = 0;
+    float best = -1;
+    for (int i = 0; i < 6; i++)
+    {
+        for (int j = i + 1; j < 6; j++)
+        {
+            float d = distance2(points[extremes[i]], points[extremes[j]]);
+            if (d > best)
+            {
+                best = d;
+                a = extremes[i];
+                b = extremes[j];
+            }
+        }
+    }
+
+    // then the point furthest from that line, and the one furthest from that plane
+    int c = a;
+    best = 0;
+    vec3 ab = normalize(points[b] - points[a]);
+    for (int i = 0; i < n; i++)
+    {
+        vec3 ap = points[i] - points[a];
+        float d = length(ap - ab * dot(ap, ab));
+        if (d > best)
+        {
+            best = d;
+            c = i;
+        }
+    }
+    int d = a;
+    HullFace base = makeFace(points, a, b, c);
+    best = 0;
+    for (int i = 0; i < n; i++)
+    {
+        float dist = fabs(distanceTo(base, points[i]));
+        if (dist > best)
+        {
+            best = dist;
+            d = i;
+        }
+    }
+    if (c == a || c == b || d == a || best <= eps)
+    {
+        // flat, so there's no volume to build faces around. The points still work for support.
+        vertices = points;
+        return;
+    }
+
+    vector<HullFace> hull;
+    if (distanceTo(base, points[d]) > 0)
+    {
+        swap(b, c);
+    }
+    hull.push_back(makeFace(points, a, b, c));
+    hull.push_back(makeFace(points, a, d, b));
+    hull.push_back(makeFace(points, b, d, c));
+    hull.push_back(makeFace(points, c, d, a));
+
+    for (int i = 0; i < n; i++)
+    {
+        if (i == a || i == b || i == c || i == d)
+        {
+            continue;
+        }
+        for (HullFace &face : hull)
+        {
+            if (distanceTo(face, points[i]) > eps)
+            {
+                face.outside.push_back(i);
+                break;
+            }
+        }
+    }
+
+    vector<int> visible;
+    vector<int> orphans;
+    vector<pair<int, int>> horizon;
+    unordered_set<long long> visibleEdges;
+    for (;;)
+    {
+        int next = -1;
+        for (int i = 0; i < (int)hull.size(); i++)
+        {
+            if (hull[i].alive && !hull[i].outside.empty())
+            {
+                next = i;
+                break;
+            }
+        }
+        if (next == -1)
+        {
+            break;
+        }
+
+        // add the point furthest out from the face
+        int eye = hull[next].outside[0];
+        float eyeDistance = distanceTo(hull[next], points[eye]);
+        for (int i : hull[next].outside)
+        {
+            float dist = distanceTo(hull[next], points[i]);
+            if (dist > eyeDistance)
+            {
+                eyeDistance = dist;
+                eye = i;
+            }
+        }
+
+        // remove every face it can see, and join it to the edge of the hole
+        visible.clear();
+        visibleEdges.clear();
+        for (int i = 0; i < (int)hull.size(); i++)
+        {
+            if (hull[i].alive && (i == next || distanceTo(hull[i], points[eye]) > eps))
+            {
+                visible.push_back(i);
+                for (int j = 0; j < 3; j++)
+                {
+                    visibleEdges.insert(edgeKey(hull[i].v[j], hull[i].v[(j + 1) % 3]));
+                }
+            }
+        }
+        horizon.clear();
+        orphans.clear();
+        for (int i : visible)
+        {
+            HullFace &face = hull[i];
+            for (int j = 0; j < 3; j++)
+            {
+                int v0 = face.v[j];
+                int v1 = face.v[(j + 1) % 3];
+                if (visibleEdges.find(edgeKey(v1, v0)) == visibleEdges.end())
+                {
+                    horizon.push_back(make_pair(v0, v1));
+                }
+            }
+            for (int p : face.outside)
+            {
+                if (p != eye)
+                {
+                    orphans.push_back(p);
+                }
+            }
+            face.outside.clear();
+            face.alive = false;
+        }
+
+        int firstNew = (int)hull.size();
+        for (auto &edge : horizon)
+        {
+            hull.push_back(makeFace(points, edge.first, edge.second, eye));
+        }
+        for (int p : orphans)
+        {
+            for (int i = firstNew; i < (int)hull.size(); i++)
+            {
+                if (distanceTo(hull[i], points[p]) > eps)
+                {
+                    hull[i].outside.push_back(p);
+                    break;
+                }
+            }
+        }
+    }
+
+    // keep only the points the faces use
+    vector<int> remap(n, -1);
+    for (HullFace &face : hull)
+    {
+        if (!face.alive)
+        {
+            continue;
+        }
+        for (int j = 0; j < 3; j++)
+        {
+            if (remap[face.v[j]] == -1)
+            {
+                remap[face.v[j]] = (int)vertices.size();
+                vertices.push_back(points[face.v[j]]);
+            }
+            faces.push_back(remap[face.v[j]]);
+        }
+        normals.push_back(face.normal);
+    }
+
+    // every edge shows up in two faces, once each way, so each direction lists one neighbor
+    int numVertices = (int)vertices.size();
+    vector<int> counts(numVertices + 1, 0);
+    for (size_t i = 0; i < faces.size(); i++)
+    {
+        counts[faces[i] + 1]++;
+    }
+    neighborStart.assign(numVertices + 1, 0);
+    for (int i = 0; i < numVertices; i++)
+    {
+        neighborStart[i + 1] = neighborStart[i] + counts[i + 1];
+    }
+    neighbors.resize(faces.size());
+    vector<int> fill(neighborStart.begin(), neighborStart.end() - 1);
+    for (size_t i = 0; i < faces.size(); i += 3)
+    {
+        for (int j = 0; j < 3; j++)
+        {
+            neighbors[fill[faces[i + j]]++] = faces[i + (j + 1) % 3];
+        }
+    }
+}
+
+vec3 ConvexHull::support(const vec3 &dir) const
+{
+    int best = 0;
+    float bestDot = dot(vertices[0], dir);
+    if ((int)vertices.size() < HULL_WALK_MIN_VERTICES || neighbors.empty())
+    {
+        for (int i = 1; i < (int)vertices.size(); i++)
+        {
+            float d = dot(vertices[i], dir);
+            if (d > bestDot)
+            {
+                bestDot = d;
+                best = i;
+            }
+        }
+        return vertices[best];
+    }
+
+    // the hull is convex, so the furthest vertex is the only one with no neighbor further along
+    bool moved = true;
+    while (moved)
+    {
+        moved = false;
+        for (int i = neighborStart[best]; i < neighborStart[best + 1]; i++)
+        {
+            float d = dot(vertices[neighbors[i]], dir);
+            if (d > bestDot)
+            {
+                bestDot = d;
+                best = neighbors[i];
+                moved = true;
+            }
+        }
+    }
+    return vertices[best];
+}
+
+vec3 ConvexHull::getFaceNormal(const vec3 &dir) const
+{
+    vec3 best = dir;
+    float bestDot = -INFINITY;
+    for (const vec3 &normal : normals)
+    {
+        float d = dot(normal, dir);
+        if (d > bestDot)
+        {
+            bestDot = d;
+            best = normal;
+        }
+    }
+    return best;
+}
+
+int ConvexHull::getNumVertices() const
+{
+    return (int)vertices.size();
+}
+
+const vector<vec3> &ConvexHull::getVertices() const
+{
+    return vertices;
+}
+
+const vector<unsigned int> &ConvexHull::getFaces() const
+{
+    return faces;
+}
+
+bool ConvexHull::empty() const
+{
+    return vertices.empty();
+}
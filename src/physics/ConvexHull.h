@@ -0,0 +1,34 @@
+#pragma once
+
+#include <glm/glm.hpp>
+#include <vector>
+
+using namespace glm;
+using namespace std;
+
+// Convex hull of a point cloud, built with quickhull.
+// Only the hull's vertices are kept for support queries, with the vertices next
+// to each one so big hulls can be searched by walking uphill instead of checking
+// every vertex.
+class ConvexHull
+{
+public:
+    ConvexHull();
+
+    void build(const vector<vec3> &points);
+    // The hull vertex furthest along dir
+    vec3 support(const vec3 &dir) const;
+    // The outward normal of the face that faces dir the most, or dir if the hull is flat
+    vec3 getFaceNormal(const vec3 &dir) const;
+    int getNumVertices() const;
+    const vector<vec3> &getVertices() const;
+    const vector<unsigned int> &getFaces() const; // 3 vertex indices per triangle, counterclockwise from outside
+    bool empty() const;
+
+private:
+    vector<vec3> vertices;
+    vector<unsigned int> faces;
+    vector<vec3> normals; // one per face
+    vector<int> neighborStart; // neighbors of vertex i are neighbors[neighborStart[i]] to neighbors[neighborStart[i + 1] - 1]
+    vector<int> neighbors;
+};
@@ -0,0 +1,442 @@
+#include "GJK.h"
+
+#include <cmath>
+#include <vector>
+
+using namespace std;
+
+#define GJK_MAX_ITERATIONS 64
+#define EPA_MAX_ITERATIONS 64
+#define EPA_TOLERANCE 1e-4f
+
+// A point of the Minkowski difference a - b, with the points of a and b it came from
+struct SupportPoint
+{
+    vec3 w;
+    vec3 a;
+    vec3 b;
+};
+
+struct EpaFace
+{
+    int v[3];
+    vec3 normal;
+    float distance;
+};
+
+static SupportPoint getSupport(const SupportShape &a, const SupportShape &b, const vec3 &dir)
+{
+    SupportPoint p;
+    p.a = a.support(dir);
+    p.b = b.support(-dir);
+    p.w = p.a - p.b;
+    return p;
+}
+
+// Closest point to the origin on triangle s[0] s[1] s[2], Real-Time Collision Detection (5.1.5).
+// Leaves only the points needed to reach it in out, with their weights.
+static vec3 closestOnTriangle(const SupportPoint *s, SupportPoint *out, int &n, float *bary)
+{
+    vec3 a = s[0].w;
+    vec3 b = s[1].w;
+    vec3 c = s[2].w;
+    vec3 ab = b - a;
+    vec3 ac = c - a;
+    float d1 = -dot(ab, a);
+    float d2 = -dot(ac, a);
+    if (d1 <= 0 && d2 <= 0)
+    {
+        out[0] = s[0];
+        n = 1;
+        bary[0] = 1;
+        return a;
+    }
+    float d3 = -dot(ab, b);
+    float d4 = -dot(ac, b);
+    if (d3 >= 0 && d4 <= d3)
+    {
+        out[0] = s[1];
+        n = 1;
+        bary[0] = 1;
+        return b;
+    }
+    float vc = d1 * d4 - d3 * d2;
+    if (vc <= 0 && d1 >= 0 && d3 <= 0)
+    {
+        float t = d1 / (d1 - d3);
+        out[0] = s[0];
+        out[1] = s[1];
+        n = 2;
+        bary[0] = 1 - t;
+        bary[1] = t;
+        return a + ab * t;
+    }
+    float d5 = -dot(ab, c);
+    float d6 = -dot(ac, c);
+    if (d6 >= 0 && d5 <= d6)
+    {
+        out[0] = s[2];
+        n = 1;
+        bary[0] = 1;
+        return c;
+    }
+    float vb = d5 * d2 - d1 * d6;
+    if (vb <= 0 && d2 >= 0 && d6 <= 0)
+    {
+        float t = d2 / (d2 - d6);
+        out[0] = s[0];
+        out[1] = s[2];
+        n = 2;
+        bary[0] = 1 - t;
+        bary[1] = t;
+        return a + ac * t;
+    }
+    float va = d3 * d6 - d5 * d4;
+    if (va <= 0 && d4 - d3 >= 0 && d5 - d6 >= 0)
+    {
+        float t = (d4 - d3) / ((d4 - d3) + (d5 - d6));
+        out[0] = s[1];
+        out[1] = s[2];
+        n = 2;
+        bary[0] = 1 - t;
+        bary[1] = t;
+        return b + (c - b) * t;
+    }
+    float sum = va + vb + vc;
+    if (sum <= 0)
+    {
+        // no area, the edge regions above didn't catch it only through rounding
+        out[0] = s[0];
+        n = 1;
+        bary[0] = 1;
+        return a;
+    }
+    float v = vb / sum;
+    float w = vc / sum;
+    out[0] = s[0];
+    out[1] = s[1];
+    out[2] = s[2];
+    n = 3;
+    bary[0] = 1 - v - w;
+    bary[1] = v;
+    bary[2] = w;
+    return a + ab * v + ac * w;
+}
+
+// Closest point to the origin on the simplex of n points, reducing it to the points
+// needed to reach it. Returns the origin if a tetrahedron contains it.
+static vec3 closestOnSimplex(SupportPoint *s, int &n, float *bary)
+{
+    if (n == 1)
+    {
+        bary[0] = 1;
+        return s[0].w;
+    }
+    if (n == 2)
+    {
+        vec3 ab = s[1].w - s[0].w;
+        float ab2 = dot(ab, ab);
+        float t = ab2 > 0 ? -dot(s[0].w, ab) / ab2 : 0.0f;
+        if (t <= 0)
+        {
+            n = 1;
+            bary[0] = 1;
+            return s[0].w;
+        }
+        if (t >= 1)
+        {
+            s[0] = s[1];
+            n = 1;
+            bary[0] = 1;
+            return s[0].w;
+        }
+        bary[0] = 1 - t;
+        bary[1] = t;
+        return s[0].w + ab * t;
+    }
+    if (n == 3)
+    {
+        SupportPoint tri[3] = {s[0], s[1], s[2]};
+        return closestOnTriangle(tri, s, n, bary);
+    }
+
+    // the faces with the origin on the other side from the fourth point
+    static const int faces[4][4] = {{0, 1, 2, 3}, {0, 2, 3, 1}, {0, 3, 1, 2}, {1, 3, 2, 0}};
+    SupportPoint tet[4] = {s[0], s[1], s[2], s[3]};
+    float best = INFINITY;
+    vec3 closest(0);
+    for (int f = 0; f < 4; f++)
+    {
+        const vec3 &a = tet[faces[f][0]].w;
+        vec3 normal = cross(tet[faces[f][1]].w - a, tet[faces[f][2]].w - a);
+        float originSide = dot(normal, -a);
+        float otherSide = dot(normal, tet[faces[f][3]].w - a);
+        if (originSide * otherSide < 0 || fabs(otherSide) < 1e-12f)
+        {
+            SupportPoint tri[3] = {tet[faces[f][0]], tet[faces[f][1]], tet[faces[f][2]]};
+            SupportPoint reduced[3];
+            float reducedBary[3];
+            int reducedN;
+            vec3 p = closestOnTriangle(tri, reduced, reducedN, reducedBary);
+            if (dot(p, p) < best)
+            {
+                best = dot(p, p);
+                closest = p;
+                n = reducedN;
+                for (int i = 0; i < reducedN; i++)
+                {
+                    s[i] = reduced[i];
+                    bary[i] = reducedBary[i];
+                }
+            }
+        }
+    }
+    return closest;
+}
+
+static void barycentric(const vec3 &p, const vec3 &a, const vec3 &b, const vec3 &c, float bary[3])
+{
+    vec3 v0 = b - a;
+    vec3 v1 = c - a;
+    vec3 v2 = p - a;
+    float d00 = dot(v0, v0);
+    float d01 = dot(v0, v1);
+    float d11 = dot(v1, v1);
+    float d20 = dot(v2, v0);
+    float d21 = dot(v2, v1);
+    float denom = d00 * d11 - d01 * d01;
+    if (denom == 0)
+    {
+        bary[0] = 1;
+        bary[1] = bary[2] = 0;
+        return;
+    }
+    bary[1] = (d11 * d20 - d01 * d21) / denom;
+    bary[2] = (d00 * d21 - d01 * d20) / denom;
+    bary[0] = 1 - bary[1] - bary[2];
+}
+
+static EpaFace makeFace(const vector<SupportPoint> &verts, int a, int b, int c)
+{
+    EpaFace face;
+    face.v[0] = a;
+    face.v[1] = b;
+    face.v[2] = c;
+    vec3 n = cross(verts[b].w - verts[a].w, verts[c].w - verts[a].w);
+    float len = length(n);
+    face.normal = len > 0 ? n / len : vec3(0);
+    face.distance = len > 0 ? dot(face.normal, verts[a].w) : INFINITY;
+    return face;
+}
+
+// GJK can stop with fewer than 4 points when the origin is on the simplex, so
+// those get built up into a tetrahedron around it
+static bool fillTetrahedron(const SupportShape &a, const SupportShape &b, SupportPoint *s, int &n)
+{
+    static const vec3 axes[6] = {vec3(1, 0, 0), vec3(-1, 0, 0), vec3(0, 1, 0), vec3(0, -1, 0), vec3(0, 0, 1), vec3(0, 0, -1)};
+    if (n == 1)
+    {
+        for (int i = 0; i < 6 && n == 1; i++)
+        {
+            SupportPoint p = getSupport(a, b, axes[i]);
+            if (length(p.w - s[0].w) > 1e-6f)
+            {
+                s[n++] = p;
+            }
+        }
+    }
+    if (n == 2)
+    {
+        vec3 d = normalize(s[1].w - s[0].w);
+        vec3 axis = fabs(d.x) < 0.57f ? vec3(1, 0, 0) : fabs(d.y) < 0.57f ? vec3(0, 1, 0) : vec3(0, 0, 1);
+        vec3 p1 = normalize(cross(d, axis));
+        vec3 p2 = cross(d, p1);
+        vec3 dirs[4] = {p1, -p1, p2, -p2};
+        for (int i = 0; i < 4 && n == 2; i++)
+        {
+            SupportPoint p = getSupport(a, b, dirs[i]);
+            vec3 off = p.w - s[0].w;
+            if (length(off - d * dot(off, d)) > 1e-6f)
+            {
+                s[n++] = p;
+            }
+        }
+    }
+    if (n == 3)
+    {
+        vec3 normal = normalize(cross(s[1].w - s[0].w, s[2].w - s[0].w));
+        for (int i = 0; i < 2 && n == 3; i++)
+        {
+            SupportPoint p = getSupport(a, b, i == 0 ? normal : -normal);
+            if (fabs(dot(p.w - s[0].w, normal)) > 1e-6f)
+            {
+                s[n++] = p;
+            }
+        }
+    }
+    return n == 4;
+}
+
+static bool expandPolytope(const SupportShape &a, const SupportShape &b, SupportPoint *s, int n, ConvexContact &contact)
+{
+    static thread_local vector<SupportPoint> verts;
+    static thread_local vector<EpaFace> faces;
+    static thread_local vector<pair<int, int>> edges;
+
+    if (!fillTetrahedron(a, b, s, n))
+    {
+        return false;
+    }
+    verts.assign(s, s + 4);
+    faces.clear();
+    vec3 center = (s[0].w + s[1].w + s[2].w + s[3].w) * 0.25f;
+    static const int tet[4][3] = {{0, 1, 2}, {0, 3, 1}, {0, 2, 3}, {1, 3, 2}};
+    for (int f = 0; f < 4; f++)
+    {
+        EpaFace face = makeFace(verts, tet[f][0], tet[f][1], tet[f][2]);
+        if (dot(face.normal, verts[tet[f][0]].w - center) < 0)
+        {
+            face = makeFace(verts, tet[f][0], tet[f][2], tet[f][1]);
+        }
+        faces.push_back(face);
+    }
+
+    int closest = 0;
+    for (int iteration = 0; iteration < EPA_MAX_ITERATIONS; iteration++)
+    {
+        closest = 0;
+        for (int i = 1; i < (int)faces.size(); i++)
+        {
+            if (faces[i].distance < faces[closest].distance)
+            {
+                closest = i;
+            }
+        }
+        EpaFace face = faces[closest];
+        SupportPoint p = getSupport(a, b, face.normal);
+        if (dot(p.w, face.normal) - face.distance < EPA_TOLERANCE)
+        {
+            break;
+        }
+
+        // cut out the faces the new point can see and fill the hole from it
+        int index = (int)verts.size();
+        verts.push_back(p);
+        edges.clear();
+        for (int i = 0; i < (int)faces.size();)
+        {
+            if (dot(faces[i].normal, p.w - verts[faces[i].v[0]].w) > 0)
+            {
+                for (int j = 0; j < 3; j++)
+                {
+                    pair<int, int> edge(faces[i].v[j], faces[i].v[(j + 1) % 3]);
+                    bool shared = false;
+                    for (size_t k = 0; k < edges.size(); k++)
+                    {
+                        if (edges[k].first == edge.second && edges[k].second == edge.first)
+                        {
+                            edges[k] = edges.back();
+                            edges.pop_back();
+                            shared = true;
+                            break;
+                        }
+                    }
+                    if (!shared)
+                    {
+                        edges.push_back(edge);
+                    }
+                }
+                faces[i] = faces.back();
+                faces.pop_back();
+            }
+            else
+            {
+                i++;
+            }
+        }
+        for (auto &edge : edges)
+        {
+            faces.push_back(makeFace(verts, edge.first, edge.second, index));
+        }
+        if (faces.empty())
+        {
+            return false;
+        }
+    }
+
+    closest = 0;
+    for (int i = 1; i < (int)faces.size(); i++)
+    {
+        if (faces[i].distance < faces[closest].distance)
+        {
+            closest = i;
+        }
+    }
+    const EpaFace &face = faces[closest];
+    if (face.normal == vec3(0))
+    {
+        return false;
+    }
+    const SupportPoint &p0 = verts[face.v[0]];
+    const SupportPoint &p1 = verts[face.v[1]];
+    const SupportPoint &p2 = verts[face.v[2]];
+    float bary[3];
+    barycentric(face.normal * face.distance, p0.w, p1.w, p2.w, bary);
+    contact.overlap = true;
+    contact.distance = 0;
+    contact.depth = (std::max)(face.distance, 0.0f);
+    contact.normal = face.normal;
+    contact.pointA = p0.a * bary[0] + p1.a * bary[1] + p2.a * bary[2];
+    contact.pointB = p0.b * bary[0] + p1.b * bary[1] + p2.b * bary[2];
+    return true;
+}
+
+bool testConvex(const SupportShape &a, const SupportShape &b, ConvexContact &contact)
+{
+    SupportPoint s[4];
+    float bary[4] = {1, 0, 0, 0};
+    int n = 1;
+    s[0] = getSupport(a, b, vec3(1, 0, 0));
+    vec3 v = s[0].w;
+
+    for (int iteration = 0; iteration < GJK_MAX_ITERATIONS; iteration++)
+    {
+        float v2 = dot(v, v);
+        if (v2 < 1e-12f)
+        {
+            return expandPolytope(a, b, s, n, contact);
+        }
+
+        // stop once the new point gets no closer to the origin than the simplex is
+        SupportPoint p = getSupport(a, b, -v);
+        bool repeated = false;
+        for (int i = 0; i < n; i++)
+        {
+            repeated = repeated || p.w == s[i].w;
+        }
+        if (repeated || v2 - dot(v, p.w) <= 1e-6f * v2)
+        {
+            break;
+        }
+
+        s[n++] = p;
+        v = closestOnSimplex(s, n, bary);
+        if (n == 4)
+        {
+            return expandPolytope(a, b, s, n, contact);
+        }
+    }
+
+    contact.overlap = false;
+    contact.depth = 0;
+    contact.pointA = vec3(0);
+    contact.pointB = vec3(0);
+    for (int i = 0; i < n; i++)
+    {
+        contact.pointA += s[i].a * bary[i];
+        contact.pointB += s[i].b * bary[i];
+    }
+    contact.distance = length(v);
+    contact.normal = contact.distance > 0 ? -v / contact.distance : vec3(0, 1, 0);
+    return true;
+}
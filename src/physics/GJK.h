@@ -0,0 +1,29 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+using namespace glm;
+
+// Something convex that GJK can test, given by its point furthest along any direction
+class SupportShape
+{
+public:
+    virtual vec3 support(const vec3 &dir) const = 0;
+};
+
+struct ConvexContact
+{
+    bool overlap;
+    float distance; // between the shapes if they don't overlap
+    float depth; // how far they overlap if they do
+    vec3 normal; // from a to b
+    vec3 pointA; // closest point on a, or deepest if they overlap
+    vec3 pointB;
+};
+
+// Tests a against b with GJK. If they're apart it finds the closest points and the
+// distance between them, otherwise EPA finds how deep they are along which normal.
+// Returns false if there's no answer, which happens when flat shapes only just touch.
+// https://caseymuratori.com/blog_0003
+// http://www.dyn4j.org/2010/05/epa-expanding-polytope-algorithm/
+bool testConvex(const SupportShape &a, const SupportShape &b, ConvexContact &contact);
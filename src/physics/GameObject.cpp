@@ -14,18 +14,14 @@ GameObject::GameObject(vec3 position, quat orientation, vec3 scale, shared_ptr<S
     this->hidden = false;
 }
 
-void GameObject::draw(shared_ptr<Program> prog, shared_ptr<MatrixStack> M)
+vec3 GameObject::getRenderPosition()
 {
-    if (model != NULL && (inView || !cull) && !hidden)
-    {
-        M->pushMatrix();
-            M->translate(position);
-            M->rotate(orientation);
-            M->scale(scale);
-            glUniformMatrix4fv(prog->getUniform("M"), 1, GL_FALSE, value_ptr(M->topMatrix()));
-            model->draw(prog);
-        M->popMatrix();
-    }
+    return position;
+}
+
+quat GameObject::getRenderOrientation()
+{
+    return orientation;
 }
 
 bool GameObject::cull = false;
@@ -1,17 +1,17 @@
 #pragma once
 
 #include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
 #include <memory>
 #include <iostream>
 
-#include "../Program.h"
 #include "../Shape.h"
-#include "../MatrixStack.h"
 #include "Collider.h"
 
 using namespace std;
 using namespace glm;
 
+// Drawing is done by drawObject in Render.h, so this doesn't need GL
 class GameObject
 {
 public:
@@ -20,7 +20,8 @@ public:
     GameObject(vec3 position, quat orientation, shared_ptr<Shape> model);
     GameObject(vec3 position, quat orientation, vec3 scale, shared_ptr<Shape> model);
     virtual void update() {};
-    virtual void draw(shared_ptr<Program> prog, shared_ptr<MatrixStack> M);
+    virtual vec3 getRenderPosition(); // where to draw it, position unless overridden
+    virtual quat getRenderOrientation();
     static void setCulling(bool cull);
 
     vec3 position;
@@ -0,0 +1,163 @@
+#include "IslandSolver.h"
+
+// Islands are handed out in jobs of at least this many objects
+#define ISLAND_MIN_BATCH 16
+
+IslandSolver::IslandSolver(shared_ptr<WorkerPool> pool) :
+    pool(pool != nullptr ? pool : make_shared<WorkerPool>()), numIslands(0)
+{
+}
+
+int IslandSolver::getNumIslands() const
+{
+    return numIslands;
+}
+
+int IslandSolver::find(int i)
+{
+    while (parent[i] != i)
+    {
+        parent[i] = parent[parent[i]];
+        i = parent[i];
+    }
+    return i;
+}
+
+void IslandSolver::unite(int a, int b)
+{
+    a = find(a);
+    b = find(b);
+    // the lower index stays the root so islands don't depend on collision order
+    if (a < b) parent[b] = a;
+    else if (b < a) parent[a] = b;
+}
+
+void IslandSolver::update(const vector<shared_ptr<PhysicsObject>> &objects)
+{
+    int n = (int)objects.size();
+    parent.resize(n);
+    objectIndex.assign(World.getNumBodies(), -1);
+    for (int i = 0; i < n; i++)
+    {
+        parent[i] = i;
+        objectIndex[objects[i]->getBody()] = i;
+    }
+
+    // Join objects that are touching
+    statics.clear();
+    for (int i = 0; i < n; i++)
+    {
+        PhysicsObject *obj = objects[i].get();
+        if (World.invMass[obj->getBody()] == 0)
+        {
+            statics.push_back(i);
+            continue;
+        }
+
+        for (int c = World.contacts.begin(obj->getBody()); c < World.contacts.end(obj->getBody()); c++)
+        {
+            int body = World.contacts[c].other->getBody();
+            int j = objectIndex[body];
+            if (j != -1 && World.invMass[body] != 0)
+            {
+                unite(i, j);
+            }
+        }
+    }
+
+    // Group the objects by island (counting sort on the root), keeping them in list order
+    islandStart.assign(n + 1, 0);
+    for (int i = 0; i < n; i++)
+    {
+        if (World.invMass[objects[i]->getBody()] != 0)
+        {
+            parent[i] = find(i);
+            islandStart[parent[i] + 1]++;
+        }
+    }
+    islands.clear();
+    batches.clear();
+    for (int root = 0; root < n; root++)
+    {
+        int size = islandStart[root + 1];
+        islandStart[root + 1] = islandStart[root] + size;
+        if (size == 0)
+        {
+            continue;
+        }
+
+        islands.push_back(islandStart[root]);
+        if (batches.empty() || islandStart[root] - batches.back() >= ISLAND_MIN_BATCH)
+        {
+            batches.push_back(islandStart[root]);
+        }
+    }
+    numIslands = (int)islands.size();
+    members.resize(islandStart[n]);
+    islands.push_back((int)members.size());
+    batches.push_back((int)members.size());
+    for (int i = 0; i < n; i++)
+    {
+        if (World.invMass[objects[i]->getBody()] != 0)
+        {
+            members[islandStart[parent[i]]++] = i;
+        }
+    }
+
+    // Wake or sleep whole islands
+    for (int k = 0; k < numIslands; k++)
+    {
+        bool awake = false;
+        bool ready = true;
+        for (int m = islands[k]; m < islands[k + 1]; m++)
+        {
+            int body = objects[members[m]]->getBody();
+            awake = awake || !World.isAsleep(body);
+            ready = ready && World.isReadyToSleep(body);
+        }
+        for (int m = islands[k]; m < islands[k + 1] && awake; m++)
+        {
+            int body = objects[members[m]]->getBody();
+            if (ready) World.sleep(body);
+            else if (World.isAsleep(body)) World.wake(body);
+        }
+    }
+
+    // Every iteration goes over the whole job, so impulses can pass between the
+    // objects of an island. Islands never share objects, so a job doing several
+    // at once doesn't change the result.
+    pool->run((int)batches.size() - 1, [&](int b) {
+        for (int m = batches[b]; m < batches[b + 1]; m++)
+        {
+            PhysicsObject *obj = objects[members[m]].get();
+            if (!World.isAsleep(obj->getBody()))
+            {
+                obj->prepareContacts();
+            }
+        }
+        for (int m = batches[b]; m < batches[b + 1]; m++)
+        {
+            PhysicsObject *obj = objects[members[m]].get();
+            if (!World.isAsleep(obj->getBody()))
+            {
+                obj->warmStartContacts();
+            }
+        }
+        for (int k = 0; k < World.solverIterations; k++)
+        {
+            for (int m = batches[b]; m < batches[b + 1]; m++)
+            {
+                PhysicsObject *obj = objects[members[m]].get();
+                if (!World.isAsleep(obj->getBody()))
+                {
+                    obj->solveContacts();
+                }
+            }
+        }
+    });
+
+    for (int i : statics)
+    {
+        objects[i]->update();
+    }
+}
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <memory>
+#include <vector>
+
+#include "PhysicsObject.h"
+#include "WorkerPool.h"
+
+using namespace std;
+
+// Resolves the contacts of every object (see PhysicsObject::update), running groups
+// of touching objects in parallel.
+// Objects are joined into islands with union-find over their contacts.
+// Objects with no mass never change the velocity the others read, so they don't
+// join islands (a floor would otherwise join everything on it) and are updated
+// once the islands are done. Inside an island every object prepares its contacts,
+// then the solver iterations go over the objects in list order, so the result
+// doesn't depend on how islands are spread over the threads.
+//
+// Islands also decide sleeping: an island with an awake object in it wakes the
+// rest, and an island where every object is ready to sleep goes to sleep and
+// isn't resolved.
+class IslandSolver
+{
+public:
+    IslandSolver(shared_ptr<WorkerPool> pool = nullptr); // makes its own pool if not given one
+
+    void update(const vector<shared_ptr<PhysicsObject>> &objects);
+    int getNumIslands() const; // in the last update, not counting objects with no mass
+
+private:
+    int find(int i);
+    void unite(int a, int b);
+
+    shared_ptr<WorkerPool> pool;
+    int numIslands;
+
+    // Scratch buffers, kept between steps so they only grow
+    vector<int> parent;
+    vector<int> objectIndex; // by body, -1 if the body isn't in the object list
+    vector<int> islandStart; // by root, where its island starts in members
+    vector<int> members; // object indices grouped by island
+    vector<int> islands; // start of each island in members
+    vector<int> batches; // start of each job in members
+    vector<int> statics;
+};
@@ -0,0 +1,187 @@
+#include "NarrowPhase.h"
+
+#include "SphereTriangleKernel.h"
+
+// Fewer pairs than this aren't worth handing to another thread
+#define NARROWPHASE_MIN_CHUNK 32
+// Chunks per thread, so a thread that gets the expensive mesh pairs doesn't hold up the rest
+#define NARROWPHASE_CHUNKS_PER_THREAD 4
+// A bucket for each ordered pair of collider types
+#define NARROWPHASE_BUCKETS (NUM_COLLIDER_TYPES * NUM_COLLIDER_TYPES)
+#define SPHERE_BUCKET (COLLIDER_SPHERE * NUM_COLLIDER_TYPES + COLLIDER_SPHERE)
+
+NarrowPhase::NarrowPhase(shared_ptr<WorkerPool> pool) :
+    pool(pool != nullptr ? pool : make_shared<WorkerPool>())
+{
+}
+
+int NarrowPhase::getNumThreads() const
+{
+    return pool->getNumThreads();
+}
+
+void NarrowPhase::run(const vector<shared_ptr<PhysicsObject>> &objects, const vector<BroadphasePair> &pairs)
+{
+    World.contacts.clear();
+
+    // Find each object's collider type and gather the spheres
+    int numObjects = (int)objects.size();
+    spheres.resize(numObjects);
+    types.resize(numObjects);
+    for (int i = 0; i < numObjects; i++)
+    {
+        PhysicsObject *obj = objects[i].get();
+        Collider *col = obj->getCollider();
+        types[i] = col == nullptr || obj->ignoreCollision ? -1 : col->type;
+        if (types[i] == COLLIDER_SPHERE)
+        {
+            spheres.set(i, obj->position, obj->getRadius());
+        }
+    }
+
+    int numPairs = (int)pairs.size();
+    int numChunks = (std::min)(numPairs / NARROWPHASE_MIN_CHUNK, pool->getNumThreads() * NARROWPHASE_CHUNKS_PER_THREAD);
+    numChunks = (std::max)(numChunks, 1);
+    if ((int)chunks.size() < numChunks)
+    {
+        chunks.resize(numChunks);
+    }
+
+    // Split up the pairs and sort each chunk's into buckets, keeping them in order
+    // within a bucket. Pairs that can't collide are left out and have no contacts.
+    order.resize(numPairs);
+    pairContacts.assign(numPairs * 2, 0);
+    spherePairs.clear();
+    for (int c = 0; c < numChunks; c++)
+    {
+        Chunk &chunk = chunks[c];
+        chunk.begin = (int)((long long)numPairs * c / numChunks);
+        chunk.end = (int)((long long)numPairs * (c + 1) / numChunks);
+
+        int fill[NARROWPHASE_BUCKETS + 1] = {};
+        for (int i = chunk.begin; i < chunk.end; i++)
+        {
+            int bucket = getBucket(pairs[i]);
+            if (bucket >= 0)
+            {
+                fill[bucket + 1]++;
+            }
+        }
+        fill[0] = chunk.begin;
+        for (int k = 0; k < NARROWPHASE_BUCKETS; k++)
+        {
+            fill[k + 1] += fill[k];
+        }
+        copy(fill, fill + NARROWPHASE_BUCKETS + 1, chunk.bucketStart);
+        for (int i = chunk.begin; i < chunk.end; i++)
+        {
+            int bucket = getBucket(pairs[i]);
+            if (bucket >= 0)
+            {
+                order[fill[bucket]++] = i;
+            }
+        }
+
+        chunk.sphereBegin = (int)spherePairs.size();
+        for (int j = chunk.bucketStart[SPHERE_BUCKET]; j < chunk.bucketStart[SPHERE_BUCKET + 1]; j++)
+        {
+            spherePairs.push_back(pairs[order[j]]);
+        }
+        chunk.sphereEnd = (int)spherePairs.size();
+    }
+
+    if (sphereContacts.size() < spherePairs.size())
+    {
+        sphereContacts.resize(spherePairs.size());
+    }
+
+    // The kernels pick an instruction set the first time they run, which isn't thread safe
+    getSphereSphereKernel();
+    getSphereTriangleKernel();
+
+    pool->run(numChunks, [&](int c) {
+        runChunk(objects, pairs, chunks[c]);
+    });
+
+    for (int c = 0; c < numChunks; c++)
+    {
+        const Chunk &chunk = chunks[c];
+        for (int i = chunk.begin; i < chunk.end; i++)
+        {
+            for (int j = pairContacts[i * 2]; j < pairContacts[i * 2 + 1]; j++)
+            {
+                World.contacts.add(chunk.contacts[j]);
+            }
+        }
+    }
+    World.contacts.group(World.getNumBodies());
+}
+
+int NarrowPhase::getBucket(const BroadphasePair &pair) const
+{
+    int a = types[pair.a];
+    int b = types[pair.b];
+    if (a < 0 || b < 0 || getCollisionTest((ColliderType)a, (ColliderType)b) == nullptr)
+    {
+        return -1;
+    }
+    return a * NUM_COLLIDER_TYPES + b;
+}
+
+void NarrowPhase::runChunk(const vector<shared_ptr<PhysicsObject>> &objects, const vector<BroadphasePair> &pairs, Chunk &chunk)
+{
+    chunk.contacts.clear();
+    setContactBuffer(&chunk.contacts);
+
+    for (int bucket = 0; bucket < NARROWPHASE_BUCKETS; bucket++)
+    {
+        int begin = chunk.bucketStart[bucket];
+        int end = chunk.bucketStart[bucket + 1];
+        if (begin == end)
+        {
+            continue;
+        }
+
+        if (bucket == SPHERE_BUCKET)
+        {
+            // spherePairs has this bucket's pairs in the same order
+            SphereContact *contacts = &sphereContacts[chunk.sphereBegin];
+            int numContacts = findSphereContacts(spheres, &spherePairs[chunk.sphereBegin], chunk.sphereEnd - chunk.sphereBegin, contacts);
+            for (int k = 0; k < numContacts; k++)
+            {
+                const SphereContact &c = contacts[k];
+                int i = order[begin + c.pair];
+                PhysicsObject *a = objects[pairs[i].a].get();
+                PhysicsObject *b = objects[pairs[i].b].get();
+                pairContacts[i * 2] = (int)chunk.contacts.size();
+
+                Collision collision;
+                collision.other = a;
+                collision.normal = c.normal;
+                collision.penetration = c.penetration;
+                collision.geom = SPHERE;
+                collision.pos = c.pos;
+                addCollision(b, collision);
+
+                collision.other = b;
+                collision.normal = -c.normal;
+                addCollision(a, collision);
+                pairContacts[i * 2 + 1] = (int)chunk.contacts.size();
+            }
+            continue;
+        }
+
+        CollisionTest test = getCollisionTest((ColliderType)(bucket / NUM_COLLIDER_TYPES), (ColliderType)(bucket % NUM_COLLIDER_TYPES));
+        for (int j = begin; j < end; j++)
+        {
+            int i = order[j];
+            PhysicsObject *a = objects[pairs[i].a].get();
+            PhysicsObject *b = objects[pairs[i].b].get();
+            pairContacts[i * 2] = (int)chunk.contacts.size();
+            test(a, a->getCollider(), b, b->getCollider());
+            pairContacts[i * 2 + 1] = (int)chunk.contacts.size();
+        }
+    }
+
+    setContactBuffer(nullptr);
+}
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <memory>
+#include <vector>
+
+#include "Broadphase.h"
+#include "ContactPool.h"
+#include "SphereSphereKernel.h"
+#include "WorkerPool.h"
+
+using namespace std;
+
+// Runs the collider tests on the pairs found by the broadphase and leaves the
+// results in World.contacts, grouped by body.
+// The pairs are sorted into buckets by the types of their colliders, and each
+// bucket is run through its one test from the table in Collider.h, so the calls in
+// a bucket all go the same way. Sphere-sphere pairs are tested together by a SIMD
+// kernel instead.
+//
+// The pair list is cut into chunks that are tested in parallel, each into its
+// own contact buffer. The buffers are then added to the pool in pair order,
+// so the result is exactly the same as calling checkCollision on every pair in
+// order, whatever the number of threads.
+class NarrowPhase
+{
+public:
+    NarrowPhase(shared_ptr<WorkerPool> pool = nullptr); // makes its own pool if not given one
+
+    void run(const vector<shared_ptr<PhysicsObject>> &objects, const vector<BroadphasePair> &pairs);
+    int getNumThreads() const;
+
+private:
+    struct Chunk
+    {
+        int begin, end; // pairs
+        int bucketStart[NUM_COLLIDER_TYPES * NUM_COLLIDER_TYPES + 1]; // into order, a bucket per pair of types
+        int sphereBegin, sphereEnd; // spherePairs
+        vector<ContactRecord> contacts;
+    };
+
+    int getBucket(const BroadphasePair &pair) const; // -1 if the pair can't collide
+    void runChunk(const vector<shared_ptr<PhysicsObject>> &objects, const vector<BroadphasePair> &pairs, Chunk &chunk);
+
+    shared_ptr<WorkerPool> pool;
+
+    // Scratch buffers, kept between steps so they only grow
+    vector<Chunk> chunks;
+    SphereSoA spheres;
+    vector<int> types; // per object, its collider type or -1 if it doesn't collide
+    vector<int> order; // pair indices sorted by bucket within each chunk
+    vector<int> pairContacts; // per pair, the start and end of its contacts in its chunk's buffer
+    vector<BroadphasePair> spherePairs;
+    vector<SphereContact> sphereContacts;
+};
@@ -14,85 +14,66 @@ PhysicsObject::PhysicsObject(vec3 position, quat orientation, vec3 scale, shared
     if (collider != nullptr) this->collider = collider;
     else this->collider = make_shared<ColliderMesh>(model);
 
-    this->netForce = vec3(0, 0, 0);
-    this->impulse = vec3(0, 0, 0);
-    this->acceleration = vec3(0, 0, 0);
-    this->velocity = vec3(0, 0, 0);
-    this->mass = 0;
-    this->invMass = 0;
-    this->normForce = vec3(0, 0, 0);
-    this->friction = 0;
-    this->elasticity = 0;
-    this->speed = 0;
+    this->previousPosition = position;
+    this->previousOrientation = orientation;
+    this->body = World.addBody(this);
     this->ignoreCollision = false;
     this->solid = true;
 }
 
-void PhysicsObject::update()
+PhysicsObject::~PhysicsObject()
 {
-    normForce = vec3(0);
-    netForce.y += GRAVITY * mass;
+    World.removeBody(body);
+}
 
-    // filter collisions so that objects don't bump over edges
-    vector<Collision *> faceCollisions;
-    vector<Collision *> notFaceCollisions;
-    for (int i = 0; i < collider->pendingCollisions.size(); i++)
-    {
-        switch (collider->pendingCollisions[i].geom)
-        {
-            case FACE:
-                faceCollisions.push_back(&collider->pendingCollisions[i]);
-                break;
-            case EDGE:
-            case VERT:
-                notFaceCollisions.push_back(&collider->pendingCollisions[i]);
-                break;
-        }
-    }
-    unordered_set<Collision *> collisionsToRemove;
-    for (int i = 0; i < faceCollisions.size(); i++)
+void PhysicsObject::update()
+{
+    prepareContacts();
+    warmStartContacts();
+    for (int i = 0; i < World.solverIterations; i++)
     {
-        for (int j = 0; j < notFaceCollisions.size(); j++)
-        {
-            if (faceCollisions[i]->other != notFaceCollisions[j]->other)
-            {
-                float d;
-                intersectRayPlane(notFaceCollisions[j]->pos, -faceCollisions[i]->normal,
-                    faceCollisions[i]->v[0], faceCollisions[i]->normal, d);
-                if (d < 0.1)
-                {
-                    collisionsToRemove.insert(notFaceCollisions[j]);
-                }
-            }
-        }
+        solveContacts();
     }
-    for (size_t i = collider->pendingCollisions.size() - 1; i >= 0 && !collisionsToRemove.empty(); i--)
+}
+
+void PhysicsObject::prepareContacts()
+{
+    ContactPool &contacts = World.contacts;
+    int begin = contacts.begin(body);
+    int end = contacts.end(body);
+
+    // filter collisions so that objects don't bump over edges, then keep a
+    // few of them with each object so it isn't pushed once per tiny face
+    if (end > begin)
     {
-        Collision *col = &collider->pendingCollisions[i];
-        if (collisionsToRemove.find(col) != collisionsToRemove.end())
-        {
-            collisionsToRemove.erase(col);
-            collider->pendingCollisions.erase(collider->pendingCollisions.begin() + i);
-        }
+        end = begin + filterEdgeContacts(&contacts[begin], end - begin);
+        end = begin + reduceContacts(&contacts[begin], end - begin);
+        contacts.setEnd(body, end);
     }
 
+    float invMass = World.invMass[body];
+    vec3 velocity = World.getVelocity(body);
+    vec3 netForce = World.getForce(body);
+    vec3 normForce = World.getNormForce(body);
+
     float maxImpact = -1;
     Collision maxImpactCollision;
-    for (Collision collision : collider->pendingCollisions)
+    for (int i = begin; i < end; i++)
     {
-        // resolve collision
+        const Collision &collision = contacts[i];
         PhysicsObject *other = collision.other;
+        ContactImpulse &impulse = contacts.getImpulse(i);
+        impulse.bounce = 0;
 
         if (!solid || !other->solid) continue;
 
-        vec3 relVel = other->velocity - velocity;
+        float otherInvMass = World.invMass[other->body];
+        vec3 relVel = World.getVelocity(other->body) - velocity;
         float velAlongNormal = dot(relVel, collision.normal);
         if (velAlongNormal < 0)
         {
-            float e = (std::min)(other->elasticity, elasticity);
-            float j = (-(1 + e) * velAlongNormal) / (invMass + other->invMass);
-            vec3 colImpulse = j * collision.normal;
-            velocity -= invMass * colImpulse;
+            float e = (std::min)(World.elasticity[other->body], World.elasticity[body]);
+            impulse.bounce = -e * velAlongNormal;
 
             // normal force
             vec3 localNormForce = collision.normal * dot(netForce, -collision.normal);
@@ -107,7 +88,7 @@ void PhysicsObject::update()
                 {
                     frictionDir = normalize(frictionDir);
                 }
-                vec3 frictionForce = length(localNormForce) * friction * frictionDir;
+                vec3 frictionForce = length(localNormForce) * World.friction[body] * frictionDir;
                 if (!isnan(frictionForce.x))
                 {
                     netForce += frictionForce;
@@ -115,11 +96,11 @@ void PhysicsObject::update()
             }
 
             // correct position to prevent sinking/jitter
-            if (other->invMass == 0)
+            if (otherInvMass == 0)
             {
                 float percent = 0.2f;
                 float slop = 0.01f;
-                vec3 correction = (std::max)(collision.penetration - slop, 0.0f) / (invMass + other->invMass) * percent * -collision.normal;
+                vec3 correction = (std::max)(collision.penetration - slop, 0.0f) / (invMass + otherInvMass) * percent * -collision.normal;
                 position += invMass * correction;
             }
 
@@ -130,40 +111,87 @@ void PhysicsObject::update()
             }
         }
     }
+    World.setVelocity(body, velocity);
+    World.setForce(body, netForce);
+    World.setNormForce(body, normForce);
+
     if (maxImpact > 0)
     {
         onHardCollision(maxImpact, maxImpactCollision);
     }
-    clearCollisions();
+}
 
-    netForce += normForce;
+// The velocity the body will have after this step if nothing pushes it, so the
+// solver can stop gravity from pulling resting objects into each other
+static vec3 getSolverVelocity(int body)
+{
+    vec3 pushes = vec3(World.impulseX[body], World.impulseY[body], World.impulseZ[body]);
+    vec3 forces = World.getForce(body) + World.getNormForce(body);
+    return World.getVelocity(body) + (pushes + forces * World.deltaTime) * World.invMass[body];
+}
 
-    velocity += impulse * invMass;
+void PhysicsObject::warmStartContacts()
+{
+    ContactPool &contacts = World.contacts;
+    int begin = contacts.begin(body);
+    int end = contacts.end(body);
+    float invMass = World.invMass[body];
 
-    // drag
-    if (velocity != vec3(0))
+    for (int i = begin; i < end; i++)
     {
-        netForce += dot(velocity, velocity) * -normalize(velocity) * DRAG_COEFFICIENT;
-    }
+        const Collision &collision = contacts[i];
+        PhysicsObject *other = collision.other;
+        ContactImpulse &impulse = contacts.getImpulse(i);
+        impulse.impulse = 0;
+        impulse.mass = 0;
+        impulse.otherInvMass = World.isMoving(other->body) ? World.invMass[other->body] : 0.0f;
+
+        // Pushing goes both ways, so when both objects have the contact only the
+        // one with the lower body solves it. Objects with no mass don't solve anything.
+        if (!solid || !other->solid || invMass == 0 ||
+            (impulse.otherInvMass != 0 && other->body < body && contacts.hasContact(other->body, this)))
+        {
+            continue;
+        }
+        impulse.mass = 1.0f / (invMass + impulse.otherInvMass);
 
-    // apply force
-    acceleration = netForce * invMass;
-    velocity += acceleration * Time.physicsDeltaTime;
-    if (fabs(velocity.x) > 0.01)
-    {
-        position.x += velocity.x * Time.physicsDeltaTime;
-    }
-    if (fabs(velocity.y) > 0.01)
-    {
-        position.y += velocity.y * Time.physicsDeltaTime;
+        // start from last step's impulse
+        impulse.impulse = contacts.getCachedImpulse(body, collision);
+        World.setVelocity(body, World.getVelocity(body) - invMass * impulse.impulse * collision.normal);
+        // static and sleeping objects are shared by islands solved at the same time, so leave them alone
+        if (impulse.otherInvMass != 0)
+        {
+            World.setVelocity(other->body, World.getVelocity(other->body) + impulse.otherInvMass * impulse.impulse * collision.normal);
+        }
     }
-    if (fabs(velocity.z) > 0.01)
+}
+
+void PhysicsObject::solveContacts()
+{
+    ContactPool &contacts = World.contacts;
+    int begin = contacts.begin(body);
+    int end = contacts.end(body);
+    float invMass = World.invMass[body];
+
+    for (int i = begin; i < end; i++)
     {
-        position.z += velocity.z * Time.physicsDeltaTime;
+        const Collision &collision = contacts[i];
+        ContactImpulse &impulse = contacts.getImpulse(i);
+        if (impulse.mass == 0) continue;
+
+        // Push until the contact separates as fast as it should bounce. The total
+        // can only push, so if earlier iterations pushed too hard this takes some back.
+        int otherBody = collision.other->body;
+        float velAlongNormal = dot(getSolverVelocity(otherBody) - getSolverVelocity(body), collision.normal);
+        float total = (std::max)(impulse.impulse + (impulse.bounce - velAlongNormal) * impulse.mass, 0.0f);
+        float j = total - impulse.impulse;
+        impulse.impulse = total;
+        World.setVelocity(body, World.getVelocity(body) - invMass * j * collision.normal);
+        if (impulse.otherInvMass != 0)
+        {
+            World.setVelocity(otherBody, World.getVelocity(otherBody) + impulse.otherInvMass * j * collision.normal);
+        }
     }
-
-    impulse = vec3(0);
-    netForce = vec3(0);
 }
 
 void PhysicsObject::start()
@@ -190,8 +218,26 @@ void PhysicsObject::checkCollision(PhysicsObject *other)
 {
     if (other->collider != NULL && collider != NULL && !other->ignoreCollision && !ignoreCollision)
     {
-        collider->checkCollision(this, other, other->collider.get());
+        CollisionTest test = getCollisionTest(collider->type, other->collider->type);
+        if (test != nullptr)
+        {
+            test(this, collider.get(), other, other->collider.get());
+        }
+    }
+}
+
+float PhysicsObject::sweep(vec3 start, PhysicsObject *other)
+{
+    if (other != this && other->collider != NULL && collider != NULL && collider->type == COLLIDER_SPHERE &&
+        !other->ignoreCollision && !ignoreCollision && solid && other->solid)
+    {
+        SweepTest test = getSweepTest(other->collider->type);
+        if (test != nullptr)
+        {
+            return test(this, static_cast<ColliderSphere *>(collider.get()), start, other, other->collider.get());
+        }
     }
+    return 1;
 }
 
 float PhysicsObject::getRadius()
@@ -210,6 +256,42 @@ float PhysicsObject::getRadius()
     }
 }
 
+Collider *PhysicsObject::getCollider()
+{
+    return collider.get();
+}
+
+int PhysicsObject::getBody()
+{
+    return body;
+}
+
+void PhysicsObject::getBounds(vec3 &min, vec3 &max)
+{
+    getBounds(position, orientation, min, max);
+}
+
+void PhysicsObject::getRenderBounds(vec3 &min, vec3 &max)
+{
+    getBounds(getRenderPosition(), getRenderOrientation(), min, max);
+}
+
+void PhysicsObject::getBounds(const vec3 &position, const quat &orientation, vec3 &min, vec3 &max)
+{
+    if (collider == NULL)
+    {
+        min = max = position;
+        return;
+    }
+
+    mat3 R = mat3_cast(orientation);
+    vec3 halfSize = abs(scale * (collider->bbox.max - collider->bbox.min)) / 2.0f;
+    vec3 center = position + R * (collider->bbox.center * scale);
+    vec3 extent = abs(R[0]) * halfSize.x + abs(R[1]) * halfSize.y + abs(R[2]) * halfSize.z;
+    min = center - extent;
+    max = center + extent;
+}
+
 vec3 PhysicsObject::getCenterPos()
 {
     if (collider == NULL || collider->bbox.center == vec3(0))
@@ -234,40 +316,51 @@ void PhysicsObject::onHardCollision(float impactVel, Collision &collision)
 
 void PhysicsObject::applyImpulse(vec3 impulse)
 {
-    this->impulse += impulse;
+    World.addImpulse(body, impulse);
+    World.wake(body);
 }
 
 void PhysicsObject::setMass(float mass)
 {
-    this->mass = mass;
-    if (mass == 0) this->invMass = 0;
-    else this->invMass = 1.0f / mass;
+    World.mass[body] = mass;
+    if (mass == 0) World.invMass[body] = 0;
+    else World.invMass[body] = 1.0f / mass;
 }
 
 void PhysicsObject::setFriction(float friction)
 {
-    this->friction = friction;
+    World.friction[body] = friction;
 }
 
 void PhysicsObject::setElasticity(float elasticity)
 {
-    this->elasticity = elasticity;
+    World.elasticity[body] = elasticity;
 }
 
 void PhysicsObject::setVelocity(vec3 velocity)
 {
-    this->velocity = velocity;
+    World.setVelocity(body, velocity);
+    World.wake(body);
 }
 
 vec3 PhysicsObject::getVelocity()
 {
-    return this->velocity;
+    return World.getVelocity(body);
 }
 
-void PhysicsObject::clearCollisions()
+void PhysicsObject::teleport(vec3 position)
 {
-    if (collider != nullptr)
-    {
-        collider->clearCollisions(this);
-    }
+    this->position = position;
+    previousPosition = position;
+    World.wake(body);
+}
+
+vec3 PhysicsObject::getRenderPosition()
+{
+    return mix(previousPosition, position, World.renderAlpha);
+}
+
+quat PhysicsObject::getRenderOrientation()
+{
+    return slerp(previousOrientation, orientation, World.renderAlpha);
 }
\ No newline at end of file
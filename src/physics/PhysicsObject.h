@@ -15,7 +15,7 @@
 #include "Collider.h"
 #include "ColliderSphere.h"
 #include "Collider.h"
-#include "../Time.h"
+#include "PhysicsWorld.h"
 #include "../Shape.h"
 
 #define GRAVITY -50.0f
@@ -25,42 +25,54 @@ using namespace std;
 using namespace glm;
 
 // https://gafferongames.com/post/physics_in_3d/
+// Velocity, forces and mass live in the PhysicsWorld, this only keeps the index
+// of its body there.
+//
+// position and orientation are the state after the latest physics step, and
+// previousPosition and previousOrientation the state at its start (see
+// PhysicsWorld::beginStep). The render position and orientation blend between
+// them by World.renderAlpha so motion looks smooth when frames and steps don't
+// line up.
+// https://gafferongames.com/post/fix_your_timestep/
 class PhysicsObject : public GameObject
 {
-private:
-    // Physical properties
-    float mass;
-    float friction;
-    float elasticity;
+    friend class PhysicsWorld;
 
 protected:
-    float invMass;
-    float speed;
-    vec3 velocity;
-    vec3 acceleration;
+    int body;
     shared_ptr<Collider> collider;
-    vec3 impulse;
-    vec3 normForce;
-    vec3 netForce; // net forces acting on ball, calculated each frame
+
+    void getBounds(const vec3 &position, const quat &orientation, vec3 &min, vec3 &max);
 
 public:
 	PhysicsObject();
     PhysicsObject(vec3 position, shared_ptr<Shape> model, shared_ptr<Collider> collider = nullptr);
     PhysicsObject(vec3 position, quat orientation, shared_ptr<Shape> model, shared_ptr<Collider> collider = nullptr);
     PhysicsObject(vec3 position, quat orientation, vec3 scale, shared_ptr<Shape> model, shared_ptr<Collider> collider = nullptr);
+    virtual ~PhysicsObject();
+    PhysicsObject(const PhysicsObject &) = delete;
+    PhysicsObject &operator=(const PhysicsObject &) = delete;
 
     // standard interface
-    /* GameObject.h: virtual void draw(shared_ptr<Program> prog, shared_ptr<MatrixStack> M)); */
     virtual void start();
-    virtual void update();
+    virtual void update(); // resolves its contacts in World.contacts, World.integrate moves the object
     virtual void lateUpdate();
     virtual void physicsUpdate();
     virtual void latePhysicsUpdate();
     virtual void onHardCollision(float impactVel, Collision &collision);
 
+    // update in parts, so the IslandSolver can run each part over a whole island
+    // before the next
+    void prepareContacts(); // filters the contacts and applies the contact forces
+    void warmStartContacts(); // applies last step's impulses, once every object in the island is prepared
+    void solveContacts(); // one solver iteration over the contacts, pushing both objects
     void checkCollision(PhysicsObject *other);
-    void clearCollisions();
+    float sweep(vec3 start, PhysicsObject *other); // see SweepTest
     float getRadius(); // get radius of bounding sphere
+    Collider *getCollider();
+    int getBody();
+    void getBounds(vec3 &min, vec3 &max); // get world space box around the collider's bounding box
+    void getRenderBounds(vec3 &min, vec3 &max); // same at the render position and orientation
     void applyImpulse(vec3 impulse);
     void setMass(float mass);
     void setFriction(float friction);
@@ -68,6 +80,11 @@ public:
     void setVelocity(vec3 velocity);
     vec3 getCenterPos();
     vec3 getVelocity();
+    void teleport(vec3 position); // move without interpolating from the old position
+    virtual vec3 getRenderPosition();
+    virtual quat getRenderOrientation();
+    vec3 previousPosition;
+    quat previousOrientation;
     bool ignoreCollision;
     bool solid;
 };
\ No newline at end of file
@@ -0,0 +1,248 @@
+#include "PhysicsWorld.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "PhysicsObject.h"
+#include "Broadphase.h"
+
+PhysicsWorld World;
+
+PhysicsWorld::PhysicsWorld() :
+    sleepDistance(0.05f), sleepSteps(50), solverIterations(8), ccd(true), ccdThreshold(0.5f), renderAlpha(0), deltaTime(0), fellAsleep(0), woken(0),
+    gravityApplied(false)
+{
+    stats.bodies = 0;
+    stats.sleeping = 0;
+    stats.fellAsleep = 0;
+    stats.woken = 0;
+}
+
+int PhysicsWorld::addBody(PhysicsObject *object)
+{
+    int body = (int)objects.size();
+    objects.push_back(object);
+
+    vector<float> *arrays[] = {&posX, &posY, &posZ, &velX, &velY, &velZ, &forceX, &forceY, &forceZ,
+        &normForceX, &normForceY, &normForceZ, &impulseX, &impulseY, &impulseZ, &mass, &invMass, &friction, &elasticity, &anchorX, &anchorY, &anchorZ};
+    for (vector<float> *a : arrays)
+    {
+        a->push_back(0);
+    }
+    stillSteps.push_back(0);
+    asleep.push_back(0);
+    stats.bodies++;
+    return body;
+}
+
+void PhysicsWorld::removeBody(int body)
+{
+    int last = (int)objects.size() - 1;
+    if (asleep[body])
+    {
+        stats.sleeping--;
+    }
+    stats.bodies--;
+    vector<float> *arrays[] = {&posX, &posY, &posZ, &velX, &velY, &velZ, &forceX, &forceY, &forceZ,
+        &normForceX, &normForceY, &normForceZ, &impulseX, &impulseY, &impulseZ, &mass, &invMass, &friction, &elasticity, &anchorX, &anchorY, &anchorZ};
+    for (vector<float> *a : arrays)
+    {
+        (*a)[body] = (*a)[last];
+        a->pop_back();
+    }
+    stillSteps[body] = stillSteps[last];
+    stillSteps.pop_back();
+    asleep[body] = asleep[last];
+    asleep.pop_back();
+
+    objects[body] = objects[last];
+    objects[body]->body = body;
+    objects.pop_back();
+    contacts.removeBody(body, last);
+}
+
+int PhysicsWorld::getNumBodies() const
+{
+    return (int)objects.size();
+}
+
+PhysicsObject *PhysicsWorld::getObject(int body) const
+{
+    return objects[body];
+}
+
+// Contacts push objects out of each other before integrate moves them, so the
+// step starts here for drawing, not in integrate
+void PhysicsWorld::beginStep(float dt)
+{
+    deltaTime = dt;
+    for (PhysicsObject *object : objects)
+    {
+        object->previousPosition = object->position;
+        object->previousOrientation = object->orientation;
+    }
+}
+
+void PhysicsWorld::applyGravity()
+{
+    int n = (int)objects.size();
+    for (int i = 0; i < n; i++)
+    {
+        forceY[i] += asleep[i] ? 0.0f : GRAVITY * mass[i];
+    }
+    gravityApplied = true;
+}
+
+void PhysicsWorld::integrate(const Broadphase &broadphase)
+{
+    float dt = deltaTime;
+    int n = (int)objects.size();
+    for (int i = 0; i < n; i++)
+    {
+        posX[i] = objects[i]->position.x;
+        posY[i] = objects[i]->position.y;
+        posZ[i] = objects[i]->position.z;
+    }
+
+    for (int i = 0; i < n; i++)
+    {
+        float fx = forceX[i] + normForceX[i];
+        float fy = forceY[i] + normForceY[i];
+        float fz = forceZ[i] + normForceZ[i];
+
+        // sleeping bodies stay where they are
+        float awake = asleep[i] ? 0.0f : 1.0f;
+
+        float vx = velX[i] + impulseX[i] * invMass[i];
+        float vy = velY[i] + impulseY[i] * invMass[i];
+        float vz = velZ[i] + impulseZ[i] * invMass[i];
+
+        // drag
+        float speed2 = vx * vx + vy * vy + vz * vz;
+        float drag = speed2 > 0 ? -std::sqrt(speed2) * DRAG_COEFFICIENT : 0.0f;
+        fx += vx * drag;
+        fy += vy * drag;
+        fz += vz * drag;
+
+        // apply force
+        vx += fx * invMass[i] * dt;
+        vy += fy * invMass[i] * dt;
+        vz += fz * invMass[i] * dt;
+        vx *= awake;
+        vy *= awake;
+        vz *= awake;
+        velX[i] = vx;
+        velY[i] = vy;
+        velZ[i] = vz;
+
+        posX[i] += std::fabs(vx) > 0.01f ? vx * dt : 0.0f;
+        posY[i] += std::fabs(vy) > 0.01f ? vy * dt : 0.0f;
+        posZ[i] += std::fabs(vz) > 0.01f ? vz * dt : 0.0f;
+
+        // restart the count whenever the body gets too far from where it started it
+        float dx = posX[i] - anchorX[i];
+        float dy = posY[i] - anchorY[i];
+        float dz = posZ[i] - anchorZ[i];
+        bool still = stillSteps[i] > 0 && dx * dx + dy * dy + dz * dz < sleepDistance * sleepDistance;
+        anchorX[i] = still ? anchorX[i] : posX[i];
+        anchorY[i] = still ? anchorY[i] : posY[i];
+        anchorZ[i] = still ? anchorZ[i] : posZ[i];
+        stillSteps[i] = still ? stillSteps[i] + 1 : 1;
+
+        impulseX[i] = impulseY[i] = impulseZ[i] = 0;
+        forceX[i] = forceY[i] = forceZ[i] = 0;
+        normForceX[i] = normForceY[i] = normForceZ[i] = 0;
+    }
+    gravityApplied = false;
+
+    if (ccd)
+    {
+        sweepFastBodies(broadphase);
+    }
+
+    for (int i = 0; i < n; i++)
+    {
+        objects[i]->position = vec3(posX[i], posY[i], posZ[i]);
+    }
+
+    stats.fellAsleep = fellAsleep;
+    stats.woken = woken;
+    fellAsleep = 0;
+    woken = 0;
+}
+
+// Objects are still at their old positions here and the new ones are in posX/Y/Z.
+// Everything is swept against where the others were at the start of the step.
+void PhysicsWorld::sweepFastBodies(const Broadphase &broadphase)
+{
+    int n = (int)objects.size();
+    for (int i = 0; i < n; i++)
+    {
+        if (asleep[i] || invMass[i] == 0)
+        {
+            continue;
+        }
+
+        PhysicsObject *obj = objects[i];
+        vec3 start = obj->position;
+        vec3 end = vec3(posX[i], posY[i], posZ[i]);
+        float threshold = obj->getRadius() * ccdThreshold;
+        if (distance2(start, end) <= threshold * threshold)
+        {
+            continue;
+        }
+
+        // only what the bounds cover on the way can be hit
+        vec3 offset = obj->getCenterPos() - start;
+        float radius = obj->getRadius();
+        vec3 min = glm::min(start, end) + offset - radius;
+        vec3 max = glm::max(start, end) + offset + radius;
+        sweepCandidates.clear();
+        broadphase.query(min, max, sweepCandidates);
+
+        obj->position = end;
+        float t = 1;
+        for (PhysicsObject *other : sweepCandidates)
+        {
+            t = (std::min)(t, obj->sweep(start, other));
+        }
+        obj->position = start;
+
+        end = start + (end - start) * t;
+        posX[i] = end.x;
+        posY[i] = end.y;
+        posZ[i] = end.z;
+    }
+}
+
+void PhysicsWorld::sleep(int body)
+{
+    if (!asleep[body])
+    {
+        asleep[body] = 1;
+        velX[body] = velY[body] = velZ[body] = 0;
+        stats.sleeping++;
+        fellAsleep++;
+    }
+}
+
+void PhysicsWorld::wake(int body)
+{
+    stillSteps[body] = 0;
+    if (asleep[body])
+    {
+        asleep[body] = 0;
+        stats.sleeping--;
+        woken++;
+        // applyGravity skipped it this step
+        if (gravityApplied)
+        {
+            forceY[body] += GRAVITY * mass[body];
+        }
+    }
+}
+
+const PhysicsStats &PhysicsWorld::getStats() const
+{
+    return stats;
+}
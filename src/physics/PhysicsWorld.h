@@ -0,0 +1,149 @@
+#pragma once
+
+#include <glm/glm.hpp>
+#include <vector>
+
+#include "ContactPool.h"
+
+using namespace glm;
+using namespace std;
+
+class PhysicsObject;
+class Broadphase;
+
+struct PhysicsStats
+{
+    int bodies;
+    int sleeping;
+    // during the last step, wakes between steps count towards the next one
+    int fellAsleep;
+    int woken;
+};
+
+// Owns the dynamic state of every PhysicsObject, one array per component so the
+// force and integration passes are simple loops the compiler can vectorize.
+// A PhysicsObject only keeps the index of its body here. Removing a body moves
+// the last body into its slot, so indices are only stable while nothing is removed.
+//
+// Bodies that have stayed within sleepDistance of one spot for sleepSteps steps
+// are put to sleep. Resting contacts keep a small bounce going, so this looks at
+// how far a body gets over the whole window rather than its velocity each step.
+// Sleeping bodies don't move, aren't paired with other sleeping or massless
+// bodies by the broadphase, and wake up when something pushes them or an awake
+// body touches them (see IslandSolver). A body woken after applyGravity gets its
+// gravity for the step when it wakes.
+//
+// Contacts are solved with sequential impulses: every contact of an island is
+// pushed apart in turn, solverIterations times over, so an impulse can travel up
+// a stack in one step. More iterations settle stacks faster and cost more. Each
+// contact starts from the impulse it ended the last step with (see ContactPool).
+//
+// Bodies that move more than ccdThreshold times their radius in a step are swept
+// against whatever the broadphase finds along the way, and stopped where they
+// first touch something, so fast spheres can't pass through thin meshes or each other.
+//
+// A physics step is:
+//     World.beginStep(dt); // keeps the state the step starts from for drawing
+//     broadphase->findPairs(objects, pairs);
+//     narrowPhase.run(objects, pairs); // fills contacts
+//     World.applyGravity();
+//     islandSolver.update(objects); // resolves the contacts, wakes and sleeps bodies
+//     World.integrate(*broadphase);
+class PhysicsWorld
+{
+public:
+    PhysicsWorld();
+
+    int addBody(PhysicsObject *object);
+    void removeBody(int body);
+    int getNumBodies() const;
+    PhysicsObject *getObject(int body) const;
+
+    // Copies every object's position and orientation to previousPosition and
+    // previousOrientation, before anything in the step moves it, and sets
+    // deltaTime for the rest of the step
+    void beginStep(float dt);
+    void applyGravity();
+    // Applies impulses, drag and the accumulated forces, moves the objects and
+    // clears the forces for the next step.
+    // Fast bodies are swept against what broadphase found in this step's findPairs.
+    void integrate(const Broadphase &broadphase);
+
+    bool isAsleep(int body) const
+    {
+        return asleep[body] != 0;
+    }
+    // Whether the body can move, so it's awake and has mass
+    bool isMoving(int body) const
+    {
+        return asleep[body] == 0 && invMass[body] != 0;
+    }
+    bool isReadyToSleep(int body) const
+    {
+        return stillSteps[body] >= sleepSteps;
+    }
+    void sleep(int body);
+    void wake(int body);
+    const PhysicsStats &getStats() const;
+
+    vec3 getVelocity(int body) const
+    {
+        return vec3(velX[body], velY[body], velZ[body]);
+    }
+    void setVelocity(int body, vec3 v)
+    {
+        velX[body] = v.x; velY[body] = v.y; velZ[body] = v.z;
+    }
+    vec3 getForce(int body) const
+    {
+        return vec3(forceX[body], forceY[body], forceZ[body]);
+    }
+    void setForce(int body, vec3 f)
+    {
+        forceX[body] = f.x; forceY[body] = f.y; forceZ[body] = f.z;
+    }
+    vec3 getNormForce(int body) const
+    {
+        return vec3(normForceX[body], normForceY[body], normForceZ[body]);
+    }
+    void setNormForce(int body, vec3 f)
+    {
+        normForceX[body] = f.x; normForceY[body] = f.y; normForceZ[body] = f.z;
+    }
+    void addImpulse(int body, vec3 j)
+    {
+        impulseX[body] += j.x; impulseY[body] += j.y; impulseZ[body] += j.z;
+    }
+
+    vector<float> posX, posY, posZ; // copied from the objects for integrate
+    vector<float> velX, velY, velZ;
+    vector<float> forceX, forceY, forceZ; // net force, calculated each step
+    vector<float> normForceX, normForceY, normForceZ;
+    vector<float> impulseX, impulseY, impulseZ;
+    vector<float> mass, invMass, friction, elasticity;
+    vector<float> anchorX, anchorY, anchorZ; // where the body was when stillSteps started counting
+    vector<int> stillSteps; // steps in a row spent within sleepDistance of the anchor
+    vector<char> asleep;
+
+    float sleepDistance;
+    int sleepSteps;
+    int solverIterations;
+    bool ccd;
+    float ccdThreshold;
+    float renderAlpha; // how far the frame is from the last step to the next one, 0 to 1
+    float deltaTime; // length of the current step, the solver and integrate both use it
+
+    ContactPool contacts; // found by the NarrowPhase this step
+
+private:
+    void sweepFastBodies(const Broadphase &broadphase);
+
+    PhysicsStats stats;
+    int fellAsleep, woken; // so far this step
+    bool gravityApplied; // between applyGravity and integrate
+    vector<PhysicsObject *> objects;
+    vector<PhysicsObject *> sweepCandidates;
+};
+
+// Every PhysicsObject lives in this world
+extern PhysicsWorld World;
@@ -0,0 +1,52 @@
+#include "Simd.h"
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+#ifdef SIMD_X86
+static bool cpuHasAVX2()
+{
+#ifdef _MSC_VER
+    int info[4];
+    __cpuid(info, 0);
+    if (info[0] < 7) return false;
+    __cpuid(info, 1);
+    bool osxsave = (info[2] & (1 << 27)) != 0;
+    bool avx = (info[2] & (1 << 28)) != 0;
+    if (!osxsave || !avx || (_xgetbv(0) & 6) != 6) return false;
+    __cpuidex(info, 7, 0);
+    return (info[1] & (1 << 5)) != 0;
+#else
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2");
+#endif
+}
+#endif
+
+bool isSimdKernelSupported(SimdKernel kernel)
+{
+    switch (kernel)
+    {
+        case KERNEL_SCALAR:
+            return true;
+#ifdef SIMD_X86
+        case KERNEL_SSE:
+            return true; // SSE2 is always there on x86-64, and assumed on 32 bit
+        case KERNEL_AVX2:
+        {
+            static bool avx2 = cpuHasAVX2();
+            return avx2;
+        }
+#endif
+        default:
+            return false;
+    }
+}
+
+SimdKernel getBestSimdKernel()
+{
+    if (isSimdKernelSupported(KERNEL_AVX2)) return KERNEL_AVX2;
+    if (isSimdKernelSupported(KERNEL_SSE)) return KERNEL_SSE;
+    return KERNEL_SCALAR;
+}
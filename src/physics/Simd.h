@@ -0,0 +1,20 @@
+#pragma once
+
+// Instruction sets the batched collision kernels can use. Each kernel picks the
+// best one the CPU supports the first time it runs, and can be forced to another.
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+#define SIMD_X86
+#include <immintrin.h>
+#ifdef _MSC_VER
+#define TARGET_AVX2
+#else
+// lets AVX2 functions be compiled without building everything with -mavx2
+#define TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+#endif
+
+enum SimdKernel {KERNEL_SCALAR, KERNEL_SSE, KERNEL_AVX2};
+
+bool isSimdKernelSupported(SimdKernel kernel);
+SimdKernel getBestSimdKernel();
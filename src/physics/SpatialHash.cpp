@@ -0,0 +1,183 @@
+#include "SpatialHash.h"
+
+SpatialHash::SpatialHash(float cellSize) :
+    cellSize(cellSize), maxCellsPerObject(64), bucketMask(0)
+{
+}
+
+// Clamped so bodies flung far away still have a cell, and a span of cells fits
+// in an int
+ivec3 SpatialHash::getCell(const vec3 &p) const
+{
+    const float limit = (float)(1 << 29);
+    return ivec3(clamp(floor(p / cellSize), vec3(-limit), vec3(limit)));
+}
+
+long long SpatialHash::countCells(const ivec3 &lo, const ivec3 &hi)
+{
+    return ((long long)hi.x - lo.x + 1) * ((long long)hi.y - lo.y + 1) * ((long long)hi.z - lo.z + 1);
+}
+
+size_t SpatialHash::getBucket(const ivec3 &cell) const
+{
+    size_t h = ((size_t)cell.x * 73856093) ^ ((size_t)cell.y * 19349663) ^ ((size_t)cell.z * 83492791);
+    return h & bucketMask;
+}
+
+void SpatialHash::query(const vec3 &min, const vec3 &max, vector<PhysicsObject *> &found) const
+{
+    ivec3 lo = getCell(min);
+    ivec3 hi = getCell(max);
+    if (countCells(lo, hi) > maxCellsPerObject || buckets.empty())
+    {
+        Broadphase::query(min, max, found);
+        return;
+    }
+
+    for (int x = lo.x; x <= hi.x; x++)
+    {
+        for (int y = lo.y; y <= hi.y; y++)
+        {
+            for (int z = lo.z; z <= hi.z; z++)
+            {
+                ivec3 cell(x, y, z);
+                size_t b = getBucket(cell);
+                for (int k = bucketStart[b]; k < bucketStart[b + 1]; k++)
+                {
+                    // objects in several of the cells are found from the one
+                    // holding the min corner of the overlap
+                    int j = buckets[k].proxy;
+                    if (buckets[k].cell == cell && overlaps(mins[j], maxs[j], min, max) &&
+                        getCell(glm::max(mins[j], min)) == cell)
+                    {
+                        found.push_back(objectList[j]);
+                    }
+                }
+            }
+        }
+    }
+    for (int j : large)
+    {
+        if (overlaps(mins[j], maxs[j], min, max))
+        {
+            found.push_back(objectList[j]);
+        }
+    }
+}
+
+void SpatialHash::findOverlaps(const vector<shared_ptr<PhysicsObject>> &objects, vector<BroadphasePair> &pairs)
+{
+    pairs.clear();
+    computeBounds(objects, sameObjects(objects));
+
+    // insert every object into each cell its bounds touch
+    entries.clear();
+    large.clear();
+    for (int i = 0; i < (int)objects.size(); i++)
+    {
+        ivec3 lo = getCell(mins[i]);
+        ivec3 hi = getCell(maxs[i]);
+        // big objects like ground planes span thousands of cells per axis
+        if (countCells(lo, hi) > maxCellsPerObject)
+        {
+            large.push_back(i);
+            continue;
+        }
+
+        Entry entry;
+        entry.proxy = i;
+        for (int x = lo.x; x <= hi.x; x++)
+        {
+            for (int y = lo.y; y <= hi.y; y++)
+            {
+                for (int z = lo.z; z <= hi.z; z++)
+                {
+                    entry.cell = ivec3(x, y, z);
+                    entries.push_back(entry);
+                }
+            }
+        }
+    }
+
+    // counting sort the entries into a power of two number of buckets
+    size_t numBuckets = 1;
+    while (numBuckets < entries.size() * 2)
+    {
+        numBuckets *= 2;
+    }
+    bucketMask = numBuckets - 1;
+    bucketStart.assign(numBuckets + 1, 0);
+    for (const Entry &entry : entries)
+    {
+        bucketStart[getBucket(entry.cell) + 1]++;
+    }
+    for (size_t i = 1; i < bucketStart.size(); i++)
+    {
+        bucketStart[i] += bucketStart[i - 1];
+    }
+    buckets.resize(entries.size());
+    for (const Entry &entry : entries)
+    {
+        buckets[bucketStart[getBucket(entry.cell)]++] = entry;
+    }
+    for (size_t i = numBuckets; i > 0; i--)
+    {
+        bucketStart[i] = bucketStart[i - 1];
+    }
+    bucketStart[0] = 0;
+
+    // only moving objects look for overlaps, in the cells they were put in
+    for (int i = 0; i < (int)objects.size(); i++)
+    {
+        if (!moving[i] || binary_search(large.begin(), large.end(), i))
+        {
+            continue;
+        }
+        ivec3 lo = getCell(mins[i]);
+        ivec3 hi = getCell(maxs[i]);
+        for (int x = lo.x; x <= hi.x; x++)
+        {
+            for (int y = lo.y; y <= hi.y; y++)
+            {
+                for (int z = lo.z; z <= hi.z; z++)
+                {
+                    ivec3 cell(x, y, z);
+                    size_t b = getBucket(cell);
+                    for (int k = bucketStart[b]; k < bucketStart[b + 1]; k++)
+                    {
+                        // different cells can hash to the same bucket
+                        int j = buckets[k].proxy;
+                        if (buckets[k].cell != cell || !reportsPair(i, j) || !overlaps(mins[i], maxs[i], mins[j], maxs[j]))
+                        {
+                            continue;
+                        }
+                        // objects can share several cells, only report the pair
+                        // from the cell holding the min corner of their overlap
+                        if (getCell(max(mins[i], mins[j])) == cell)
+                        {
+                            pairs.push_back(makePair(i, j));
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+    for (int i : large)
+    {
+        for (int j = 0; j < (int)objects.size(); j++)
+        {
+            bool jLarge = binary_search(large.begin(), large.end(), j);
+            if (j == i || (jLarge && j < i) || !(moving[i] || moving[j]))
+            {
+                continue;
+            }
+            if (overlaps(mins[i], maxs[i], mins[j], maxs[j]))
+            {
+                pairs.push_back(makePair(i, j));
+            }
+        }
+    }
+
+    sort(pairs.begin(), pairs.end());
+}
@@ -0,0 +1,42 @@
+#pragma once
+
+#include "Broadphase.h"
+
+// http://www.cs.ucr.edu/~vbz/resources/spatialhashing.pdf
+// Uniform grid stored in a hash table, rebuilt every step with a counting
+// sort so there are no allocations once the buffers have grown. Works best
+// when objects are all about the size of a cell, e.g. big groups of spheres.
+// Objects that cover too many cells are kept out of the grid and tested
+// against everything instead. Every object goes in the grid, but only moving
+// ones look for overlaps in it.
+class SpatialHash : public Broadphase
+{
+public:
+    SpatialHash(float cellSize = 2.0f);
+
+    float cellSize;
+    int maxCellsPerObject;
+
+    // Looks in the cells the box covers, or at every object if that's too many
+    virtual void query(const vec3 &min, const vec3 &max, vector<PhysicsObject *> &found) const;
+
+protected:
+    virtual void findOverlaps(const vector<shared_ptr<PhysicsObject>> &objects, vector<BroadphasePair> &pairs);
+
+private:
+    struct Entry
+    {
+        ivec3 cell;
+        int proxy;
+    };
+
+    ivec3 getCell(const vec3 &p) const;
+    static long long countCells(const ivec3 &lo, const ivec3 &hi); // in the box of cells from lo to hi
+    size_t getBucket(const ivec3 &cell) const;
+
+    vector<Entry> entries;
+    vector<Entry> buckets; // entries sorted by bucket
+    vector<int> bucketStart;
+    size_t bucketMask;
+    vector<int> large; // objects too big for the grid
+};
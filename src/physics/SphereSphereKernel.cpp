@@ -0,0 +1,231 @@
+#include "SphereSphereKernel.h"
+
+#include <cmath>
+
+// The kernels use the same operations in the same order as checkSphereSphere, and
+// nothing they do can be contracted into an FMA, so every kernel gives the same bits.
+
+void SphereSoA::resize(int count)
+{
+    x.resize(count);
+    y.resize(count);
+    z.resize(count);
+    radius.resize(count);
+}
+
+void SphereSoA::set(int i, vec3 position, float r)
+{
+    x[i] = position.x;
+    y[i] = position.y;
+    z[i] = position.z;
+    radius[i] = r;
+}
+
+static inline bool testPair(const SphereSoA &s, const BroadphasePair &pair, SphereContact &contact)
+{
+    int a = pair.a, b = pair.b;
+    float dx = s.x[b] - s.x[a];
+    float dy = s.y[b] - s.y[a];
+    float dz = s.z[b] - s.z[a];
+    float d = std::sqrt(dx * dx + dy * dy + dz * dz);
+    float r = s.radius[b] + s.radius[a];
+    if (!(d < r))
+    {
+        return false;
+    }
+
+    float inv = 1.0f / d;
+    contact.normal = vec3(-(dx * inv), -(dy * inv), -(dz * inv));
+    contact.penetration = r - d;
+    contact.pos = vec3(s.x[a] + contact.normal.x * s.radius[a],
+        s.y[a] + contact.normal.y * s.radius[a],
+        s.z[a] + contact.normal.z * s.radius[a]);
+    return true;
+}
+
+static int findSphereContactsScalar(const SphereSoA &spheres, const BroadphasePair *pairs, int start, int count, SphereContact *contacts)
+{
+    int numContacts = 0;
+    for (int i = start; i < count; i++)
+    {
+        if (testPair(spheres, pairs[i], contacts[numContacts]))
+        {
+            contacts[numContacts++].pair = i;
+        }
+    }
+    return numContacts;
+}
+
+#ifdef SIMD_X86
+
+// Writes out the lanes of a packet that overlapped
+static inline int writeContacts(int bits, int first, const float *pen, const float *n, const float *p, SphereContact *contacts)
+{
+    int numContacts = 0;
+    while (bits)
+    {
+        int lane = 0;
+        while (!(bits & (1 << lane))) lane++;
+        SphereContact &contact = contacts[numContacts++];
+        contact.pair = first + lane;
+        contact.penetration = pen[lane];
+        contact.normal = vec3(n[lane], n[8 + lane], n[16 + lane]);
+        contact.pos = vec3(p[lane], p[8 + lane], p[16 + lane]);
+        bits &= bits - 1;
+    }
+    return numContacts;
+}
+
+// SSE2 has no gathers, so the 4 pairs are loaded one lane at a time
+static int findSphereContactsSSE(const SphereSoA &s, const BroadphasePair *pairs, int count, SphereContact *contacts)
+{
+    const __m128 signBit = _mm_set1_ps(-0.0f);
+    const __m128 one = _mm_set1_ps(1.0f);
+    float pen[8], n[24], p[24];
+
+    int numContacts = 0;
+    int i = 0;
+    for (; i + 4 <= count; i += 4)
+    {
+        const BroadphasePair *pr = pairs + i;
+        __m128 ax = _mm_setr_ps(s.x[pr[0].a], s.x[pr[1].a], s.x[pr[2].a], s.x[pr[3].a]);
+        __m128 ay = _mm_setr_ps(s.y[pr[0].a], s.y[pr[1].a], s.y[pr[2].a], s.y[pr[3].a]);
+        __m128 az = _mm_setr_ps(s.z[pr[0].a], s.z[pr[1].a], s.z[pr[2].a], s.z[pr[3].a]);
+        __m128 ar = _mm_setr_ps(s.radius[pr[0].a], s.radius[pr[1].a], s.radius[pr[2].a], s.radius[pr[3].a]);
+        __m128 bx = _mm_setr_ps(s.x[pr[0].b], s.x[pr[1].b], s.x[pr[2].b], s.x[pr[3].b]);
+        __m128 by = _mm_setr_ps(s.y[pr[0].b], s.y[pr[1].b], s.y[pr[2].b], s.y[pr[3].b]);
+        __m128 bz = _mm_setr_ps(s.z[pr[0].b], s.z[pr[1].b], s.z[pr[2].b], s.z[pr[3].b]);
+        __m128 br = _mm_setr_ps(s.radius[pr[0].b], s.radius[pr[1].b], s.radius[pr[2].b], s.radius[pr[3].b]);
+
+        __m128 dx = _mm_sub_ps(bx, ax);
+        __m128 dy = _mm_sub_ps(by, ay);
+        __m128 dz = _mm_sub_ps(bz, az);
+        __m128 d = _mm_sqrt_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)), _mm_mul_ps(dz, dz)));
+        __m128 r = _mm_add_ps(br, ar);
+        int bits = _mm_movemask_ps(_mm_cmplt_ps(d, r));
+        if (!bits)
+        {
+            continue;
+        }
+
+        __m128 inv = _mm_div_ps(one, d);
+        __m128 nx = _mm_xor_ps(_mm_mul_ps(dx, inv), signBit);
+        __m128 ny = _mm_xor_ps(_mm_mul_ps(dy, inv), signBit);
+        __m128 nz = _mm_xor_ps(_mm_mul_ps(dz, inv), signBit);
+        _mm_storeu_ps(pen, _mm_sub_ps(r, d));
+        _mm_storeu_ps(n, nx);
+        _mm_storeu_ps(n + 8, ny);
+        _mm_storeu_ps(n + 16, nz);
+        _mm_storeu_ps(p, _mm_add_ps(ax, _mm_mul_ps(nx, ar)));
+        _mm_storeu_ps(p + 8, _mm_add_ps(ay, _mm_mul_ps(ny, ar)));
+        _mm_storeu_ps(p + 16, _mm_add_ps(az, _mm_mul_ps(nz, ar)));
+        numContacts += writeContacts(bits, i, pen, n, p, contacts + numContacts);
+    }
+    return numContacts + findSphereContactsScalar(s, pairs, i, count, contacts + numContacts);
+}
+
+// Gathers 8 pairs at a time straight out of the pair list
+TARGET_AVX2 static int findSphereContactsAVX2(const SphereSoA &s, const BroadphasePair *pairs, int count, SphereContact *contacts)
+{
+    static_assert(sizeof(BroadphasePair) == 2 * sizeof(int), "pairs are gathered as an int array");
+    const int *ids = reinterpret_cast<const int *>(pairs);
+    const __m256i stride = _mm256_setr_epi32(0, 2, 4, 6, 8, 10, 12, 14);
+    const __m256 signBit = _mm256_set1_ps(-0.0f);
+    const __m256 one = _mm256_set1_ps(1.0f);
+    float pen[8], n[24], p[24];
+
+    int numContacts = 0;
+    int i = 0;
+    for (; i + 8 <= count; i += 8)
+    {
+        __m256i a = _mm256_i32gather_epi32(ids + 2 * i, stride, 4);
+        __m256i b = _mm256_i32gather_epi32(ids + 2 * i + 1, stride, 4);
+        __m256 ax = _mm256_i32gather_ps(&s.x[0], a, 4);
+        __m256 ay = _mm256_i32gather_ps(&s.y[0], a, 4);
+        __m256 az = _mm256_i32gather_ps(&s.z[0], a, 4);
+        __m256 ar = _mm256_i32gather_ps(&s.radius[0], a, 4);
+        __m256 bx = _mm256_i32gather_ps(&s.x[0], b, 4);
+        __m256 by = _mm256_i32gather_ps(&s.y[0], b, 4);
+        __m256 bz = _mm256_i32gather_ps(&s.z[0], b, 4);
+        __m256 br = _mm256_i32gather_ps(&s.radius[0], b, 4);
+
+        __m256 dx = _mm256_sub_ps(bx, ax);
+        __m256 dy = _mm256_sub_ps(by, ay);
+        __m256 dz = _mm256_sub_ps(bz, az);
+        __m256 d = _mm256_sqrt_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(dx, dx), _mm256_mul_ps(dy, dy)), _mm256_mul_ps(dz, dz)));
+        __m256 r = _mm256_add_ps(br, ar);
+        int bits = _mm256_movemask_ps(_mm256_cmp_ps(d, r, _CMP_LT_OQ));
+        if (!bits)
+        {
+            continue;
+        }
+
+        __m256 inv = _mm256_div_ps(one, d);
+        __m256 nx = _mm256_xor_ps(_mm256_mul_ps(dx, inv), signBit);
+        __m256 ny = _mm256_xor_ps(_mm256_mul_ps(dy, inv), signBit);
+        __m256 nz = _mm256_xor_ps(_mm256_mul_ps(dz, inv), signBit);
+        _mm256_storeu_ps(pen, _mm256_sub_ps(r, d));
+        _mm256_storeu_ps(n, nx);
+        _mm256_storeu_ps(n + 8, ny);
+        _mm256_storeu_ps(n + 16, nz);
+        _mm256_storeu_ps(p, _mm256_add_ps(ax, _mm256_mul_ps(nx, ar)));
+        _mm256_storeu_ps(p + 8, _mm256_add_ps(ay, _mm256_mul_ps(ny, ar)));
+        _mm256_storeu_ps(p + 16, _mm256_add_ps(az, _mm256_mul_ps(nz, ar)));
+        numContacts += writeContacts(bits, i, pen, n, p, contacts + numContacts);
+    }
+    return numContacts + findSphereContactsScalar(s, pairs, i, count, contacts + numContacts);
+}
+
+#endif
+
+static int findSphereContactsAll(const SphereSoA &spheres, const BroadphasePair *pairs, int count, SphereContact *contacts)
+{
+    return findSphereContactsScalar(spheres, pairs, 0, count, contacts);
+}
+
+typedef int (*SphereContactsFn)(const SphereSoA &, const BroadphasePair *, int, SphereContact *);
+
+static SimdKernel currentKernel = KERNEL_SCALAR;
+static SphereContactsFn currentFn = findSphereContactsAll;
+static bool kernelChosen = false;
+
+bool setSphereSphereKernel(SimdKernel kernel)
+{
+    if (!isSimdKernelSupported(kernel))
+    {
+        return false;
+    }
+
+    currentKernel = kernel;
+    kernelChosen = true;
+    switch (kernel)
+    {
+#ifdef SIMD_X86
+        case KERNEL_SSE:
+            currentFn = findSphereContactsSSE;
+            break;
+        case KERNEL_AVX2:
+            currentFn = findSphereContactsAVX2;
+            break;
+#endif
+        default:
+            currentFn = findSphereContactsAll;
+            break;
+    }
+    return true;
+}
+
+SimdKernel getSphereSphereKernel()
+{
+    if (!kernelChosen)
+    {
+        setSphereSphereKernel(getBestSimdKernel());
+    }
+    return currentKernel;
+}
+
+int findSphereContacts(const SphereSoA &spheres, const BroadphasePair *pairs, int count, SphereContact *contacts)
+{
+    getSphereSphereKernel();
+    return currentFn(spheres, pairs, count, contacts);
+}
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <glm/glm.hpp>
+#include <vector>
+
+#include "Broadphase.h"
+#include "Simd.h"
+
+using namespace glm;
+using namespace std;
+
+// Positions and radii of the objects in a scene, one array per component, indexed
+// like the object list the broadphase pairs refer to. Only the entries of spheres
+// have to be filled in.
+struct SphereSoA
+{
+    void resize(int count);
+    void set(int i, vec3 position, float radius);
+
+    vector<float> x, y, z, radius;
+};
+
+// An overlap found by findSphereContacts, with the same values checkSphereSphere
+// would give. normal and pos are the contact as seen from pair b, a gets -normal.
+struct SphereContact
+{
+    int pair; // index into the pair list
+    float penetration;
+    vec3 normal;
+    vec3 pos;
+};
+
+// Tests each pair of spheres and writes a contact for every overlapping one, in pair
+// order. contacts needs room for count entries. Returns the number of contacts.
+int findSphereContacts(const SphereSoA &spheres, const BroadphasePair *pairs, int count, SphereContact *contacts);
+
+// The kernel starts out as the fastest one the CPU supports
+SimdKernel getSphereSphereKernel();
+bool setSphereSphereKernel(SimdKernel kernel); // false if the CPU doesn't support it
@@ -0,0 +1,351 @@
+#include "SphereTriangleKernel.h"
+
+#include "Collider.h"
+#include "../Shape.h"
+
+// Lanes are accepted with a little slack so the SIMD kernels never drop a
+// triangle that the scalar closest point test would have kept
+#define KERNEL_RADIUS_SLACK 1.0001f
+
+void TriangleSoA::build(Shape &shape)
+{
+    count = shape.bvh.getNumFaces();
+    // a packet can start at any triangle, so leave room for one to run off the end
+    int padded = count + 7;
+    vector<float> *arrays[9] = {&ax, &ay, &az, &bx, &by, &bz, &cx, &cy, &cz};
+    for (int i = 0; i < 9; i++)
+    {
+        arrays[i]->assign(padded, 0.0f);
+    }
+
+    for (int i = 0; i < count; i++)
+    {
+        int face = shape.bvh.getFace(i);
+        for (int j = 0; j < 3; j++)
+        {
+            vec3 v = shape.getLocalVertex(shape.getFaceIndex(face, j));
+            (*arrays[j * 3])[i] = v.x;
+            (*arrays[j * 3 + 1])[i] = v.y;
+            (*arrays[j * 3 + 2])[i] = v.z;
+        }
+    }
+}
+
+static int findSphereTrianglesScalar(const TriangleSoA &tris, int start, int count, const mat4 &M, vec3 center, float radius, int *hits)
+{
+    int numHits = 0;
+    for (int i = start; i < start + count; i++)
+    {
+        vec3 a = vec3(M * vec4(tris.ax[i], tris.ay[i], tris.az[i], 1.0f));
+        vec3 b = vec3(M * vec4(tris.bx[i], tris.by[i], tris.bz[i], 1.0f));
+        vec3 c = vec3(M * vec4(tris.cx[i], tris.cy[i], tris.cz[i], 1.0f));
+        vec3 closest;
+        int feature;
+        closestPointOnTriangle(center, a, b, c, closest, feature);
+        if (distance2(center, closest) < radius * radius)
+        {
+            hits[numHits++] = i;
+        }
+    }
+    return numHits;
+}
+
+#ifdef SIMD_X86
+
+// SSE2 only has bitwise selects
+static inline __m128 select4(__m128 mask, __m128 a, __m128 b)
+{
+    return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b));
+}
+
+// Closest point on each of 4 triangles, same regions as closestPointOnTriangle
+static int findSphereTrianglesSSE(const TriangleSoA &tris, int start, int count, const mat4 &M, vec3 center, float radius, int *hits)
+{
+    __m128 m[12];
+    for (int col = 0; col < 4; col++)
+    {
+        for (int row = 0; row < 3; row++)
+        {
+            m[col * 3 + row] = _mm_set1_ps(M[col][row]);
+        }
+    }
+    __m128 px = _mm_set1_ps(center.x);
+    __m128 py = _mm_set1_ps(center.y);
+    __m128 pz = _mm_set1_ps(center.z);
+    __m128 r2 = _mm_set1_ps(radius * radius * KERNEL_RADIUS_SLACK);
+    __m128 zero = _mm_setzero_ps();
+
+    int numHits = 0;
+    for (int i = start; i < start + count; i += 4)
+    {
+        __m128 v[9];
+        const float *src[9] = {&tris.ax[i], &tris.ay[i], &tris.az[i], &tris.bx[i], &tris.by[i], &tris.bz[i], &tris.cx[i], &tris.cy[i], &tris.cz[i]};
+        for (int j = 0; j < 3; j++)
+        {
+            __m128 x = _mm_loadu_ps(src[j * 3]);
+            __m128 y = _mm_loadu_ps(src[j * 3 + 1]);
+            __m128 z = _mm_loadu_ps(src[j * 3 + 2]);
+            for (int row = 0; row < 3; row++)
+            {
+                v[j * 3 + row] = _mm_add_ps(_mm_add_ps(_mm_mul_ps(m[row], x), _mm_mul_ps(m[3 + row], y)),
+                    _mm_add_ps(_mm_mul_ps(m[6 + row], z), m[9 + row]));
+            }
+        }
+
+        __m128 abx = _mm_sub_ps(v[3], v[0]), aby = _mm_sub_ps(v[4], v[1]), abz = _mm_sub_ps(v[5], v[2]);
+        __m128 acx = _mm_sub_ps(v[6], v[0]), acy = _mm_sub_ps(v[7], v[1]), acz = _mm_sub_ps(v[8], v[2]);
+        __m128 apx = _mm_sub_ps(px, v[0]), apy = _mm_sub_ps(py, v[1]), apz = _mm_sub_ps(pz, v[2]);
+        __m128 bpx = _mm_sub_ps(px, v[3]), bpy = _mm_sub_ps(py, v[4]), bpz = _mm_sub_ps(pz, v[5]);
+        __m128 cpx = _mm_sub_ps(px, v[6]), cpy = _mm_sub_ps(py, v[7]), cpz = _mm_sub_ps(pz, v[8]);
+
+#define DOT4(ax, ay, az, bx, by, bz) _mm_add_ps(_mm_add_ps(_mm_mul_ps(ax, bx), _mm_mul_ps(ay, by)), _mm_mul_ps(az, bz))
+        __m128 d1 = DOT4(abx, aby, abz, apx, apy, apz);
+        __m128 d2 = DOT4(acx, acy, acz, apx, apy, apz);
+        __m128 d3 = DOT4(abx, aby, abz, bpx, bpy, bpz);
+        __m128 d4 = DOT4(acx, acy, acz, bpx, bpy, bpz);
+        __m128 d5 = DOT4(abx, aby, abz, cpx, cpy, cpz);
+        __m128 d6 = DOT4(acx, acy, acz, cpx, cpy, cpz);
+#undef DOT4
+        __m128 va = _mm_sub_ps(_mm_mul_ps(d3, d6), _mm_mul_ps(d5, d4));
+        __m128 vb = _mm_sub_ps(_mm_mul_ps(d5, d2), _mm_mul_ps(d1, d6));
+        __m128 vc = _mm_sub_ps(_mm_mul_ps(d1, d4), _mm_mul_ps(d3, d2));
+
+        // start with the face region and let each earlier region override it
+        __m128 denom = _mm_div_ps(_mm_set1_ps(1.0f), _mm_add_ps(_mm_add_ps(va, vb), vc));
+        __m128 s = _mm_mul_ps(vb, denom);
+        __m128 t = _mm_mul_ps(vc, denom);
+        __m128 qx = _mm_add_ps(v[0], _mm_add_ps(_mm_mul_ps(abx, s), _mm_mul_ps(acx, t)));
+        __m128 qy = _mm_add_ps(v[1], _mm_add_ps(_mm_mul_ps(aby, s), _mm_mul_ps(acy, t)));
+        __m128 qz = _mm_add_ps(v[2], _mm_add_ps(_mm_mul_ps(abz, s), _mm_mul_ps(acz, t)));
+
+        // edge bc
+        __m128 d43 = _mm_sub_ps(d4, d3);
+        __m128 d56 = _mm_sub_ps(d5, d6);
+        __m128 mask = _mm_and_ps(_mm_cmple_ps(va, zero), _mm_and_ps(_mm_cmpge_ps(d43, zero), _mm_cmpge_ps(d56, zero)));
+        t = _mm_div_ps(d43, _mm_add_ps(d43, d56));
+        qx = select4(mask, _mm_add_ps(v[3], _mm_mul_ps(_mm_sub_ps(v[6], v[3]), t)), qx);
+        qy = select4(mask, _mm_add_ps(v[4], _mm_mul_ps(_mm_sub_ps(v[7], v[4]), t)), qy);
+        qz = select4(mask, _mm_add_ps(v[5], _mm_mul_ps(_mm_sub_ps(v[8], v[5]), t)), qz);
+
+        // edge ac
+        mask = _mm_and_ps(_mm_cmple_ps(vb, zero), _mm_and_ps(_mm_cmpge_ps(d2, zero), _mm_cmple_ps(d6, zero)));
+        t = _mm_div_ps(d2, _mm_sub_ps(d2, d6));
+        qx = select4(mask, _mm_add_ps(v[0], _mm_mul_ps(acx, t)), qx);
+        qy = select4(mask, _mm_add_ps(v[1], _mm_mul_ps(acy, t)), qy);
+        qz = select4(mask, _mm_add_ps(v[2], _mm_mul_ps(acz, t)), qz);
+
+        // vertex c
+        mask = _mm_and_ps(_mm_cmpge_ps(d6, zero), _mm_cmple_ps(d5, d6));
+        qx = select4(mask, v[6], qx);
+        qy = select4(mask, v[7], qy);
+        qz = select4(mask, v[8], qz);
+
+        // edge ab
+        mask = _mm_and_ps(_mm_cmple_ps(vc, zero), _mm_and_ps(_mm_cmpge_ps(d1, zero), _mm_cmple_ps(d3, zero)));
+        t = _mm_div_ps(d1, _mm_sub_ps(d1, d3));
+        qx = select4(mask, _mm_add_ps(v[0], _mm_mul_ps(abx, t)), qx);
+        qy = select4(mask, _mm_add_ps(v[1], _mm_mul_ps(aby, t)), qy);
+        qz = select4(mask, _mm_add_ps(v[2], _mm_mul_ps(abz, t)), qz);
+
+        // vertex b
+        mask = _mm_and_ps(_mm_cmpge_ps(d3, zero), _mm_cmple_ps(d4, d3));
+        qx = select4(mask, v[3], qx);
+        qy = select4(mask, v[4], qy);
+        qz = select4(mask, v[5], qz);
+
+        // vertex a
+        mask = _mm_and_ps(_mm_cmple_ps(d1, zero), _mm_cmple_ps(d2, zero));
+        qx = select4(mask, v[0], qx);
+        qy = select4(mask, v[1], qy);
+        qz = select4(mask, v[2], qz);
+
+        __m128 dx = _mm_sub_ps(px, qx);
+        __m128 dy = _mm_sub_ps(py, qy);
+        __m128 dz = _mm_sub_ps(pz, qz);
+        __m128 dist2 = _mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)), _mm_mul_ps(dz, dz));
+        int bits = _mm_movemask_ps(_mm_cmplt_ps(dist2, r2));
+
+        // ignore the lanes past the end of the range
+        int lanes = start + count - i;
+        if (lanes < 4)
+        {
+            bits &= (1 << lanes) - 1;
+        }
+        while (bits)
+        {
+            int lane = 0;
+            while (!(bits & (1 << lane))) lane++;
+            hits[numHits++] = i + lane;
+            bits &= bits - 1;
+        }
+    }
+    return numHits;
+}
+
+// Same as the SSE kernel on 8 triangles at a time
+TARGET_AVX2 static int findSphereTrianglesAVX2(const TriangleSoA &tris, int start, int count, const mat4 &M, vec3 center, float radius, int *hits)
+{
+    __m256 m[12];
+    for (int col = 0; col < 4; col++)
+    {
+        for (int row = 0; row < 3; row++)
+        {
+            m[col * 3 + row] = _mm256_set1_ps(M[col][row]);
+        }
+    }
+    __m256 px = _mm256_set1_ps(center.x);
+    __m256 py = _mm256_set1_ps(center.y);
+    __m256 pz = _mm256_set1_ps(center.z);
+    __m256 r2 = _mm256_set1_ps(radius * radius * KERNEL_RADIUS_SLACK);
+    __m256 zero = _mm256_setzero_ps();
+
+    int numHits = 0;
+    for (int i = start; i < start + count; i += 8)
+    {
+        __m256 v[9];
+        const float *src[9] = {&tris.ax[i], &tris.ay[i], &tris.az[i], &tris.bx[i], &tris.by[i], &tris.bz[i], &tris.cx[i], &tris.cy[i], &tris.cz[i]};
+        for (int j = 0; j < 3; j++)
+        {
+            __m256 x = _mm256_loadu_ps(src[j * 3]);
+            __m256 y = _mm256_loadu_ps(src[j * 3 + 1]);
+            __m256 z = _mm256_loadu_ps(src[j * 3 + 2]);
+            for (int row = 0; row < 3; row++)
+            {
+                v[j * 3 + row] = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(m[row], x), _mm256_mul_ps(m[3 + row], y)),
+                    _mm256_add_ps(_mm256_mul_ps(m[6 + row], z), m[9 + row]));
+            }
+        }
+
+        __m256 abx = _mm256_sub_ps(v[3], v[0]), aby = _mm256_sub_ps(v[4], v[1]), abz = _mm256_sub_ps(v[5], v[2]);
+        __m256 acx = _mm256_sub_ps(v[6], v[0]), acy = _mm256_sub_ps(v[7], v[1]), acz = _mm256_sub_ps(v[8], v[2]);
+        __m256 apx = _mm256_sub_ps(px, v[0]), apy = _mm256_sub_ps(py, v[1]), apz = _mm256_sub_ps(pz, v[2]);
+        __m256 bpx = _mm256_sub_ps(px, v[3]), bpy = _mm256_sub_ps(py, v[4]), bpz = _mm256_sub_ps(pz, v[5]);
+        __m256 cpx = _mm256_sub_ps(px, v[6]), cpy = _mm256_sub_ps(py, v[7]), cpz = _mm256_sub_ps(pz, v[8]);
+
+#define DOT8(ax, ay, az, bx, by, bz) _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(ax, bx), _mm256_mul_ps(ay, by)), _mm256_mul_ps(az, bz))
+        __m256 d1 = DOT8(abx, aby, abz, apx, apy, apz);
+        __m256 d2 = DOT8(acx, acy, acz, apx, apy, apz);
+        __m256 d3 = DOT8(abx, aby, abz, bpx, bpy, bpz);
+        __m256 d4 = DOT8(acx, acy, acz, bpx, bpy, bpz);
+        __m256 d5 = DOT8(abx, aby, abz, cpx, cpy, cpz);
+        __m256 d6 = DOT8(acx, acy, acz, cpx, cpy, cpz);
+#undef DOT8
+        __m256 va = _mm256_sub_ps(_mm256_mul_ps(d3, d6), _mm256_mul_ps(d5, d4));
+        __m256 vb = _mm256_sub_ps(_mm256_mul_ps(d5, d2), _mm256_mul_ps(d1, d6));
+        __m256 vc = _mm256_sub_ps(_mm256_mul_ps(d1, d4), _mm256_mul_ps(d3, d2));
+
+        __m256 denom = _mm256_div_ps(_mm256_set1_ps(1.0f), _mm256_add_ps(_mm256_add_ps(va, vb), vc));
+        __m256 s = _mm256_mul_ps(vb, denom);
+        __m256 t = _mm256_mul_ps(vc, denom);
+        __m256 qx = _mm256_add_ps(v[0], _mm256_add_ps(_mm256_mul_ps(abx, s), _mm256_mul_ps(acx, t)));
+        __m256 qy = _mm256_add_ps(v[1], _mm256_add_ps(_mm256_mul_ps(aby, s), _mm256_mul_ps(acy, t)));
+        __m256 qz = _mm256_add_ps(v[2], _mm256_add_ps(_mm256_mul_ps(abz, s), _mm256_mul_ps(acz, t)));
+
+        __m256 d43 = _mm256_sub_ps(d4, d3);
+        __m256 d56 = _mm256_sub_ps(d5, d6);
+        __m256 mask = _mm256_and_ps(_mm256_cmp_ps(va, zero, _CMP_LE_OQ),
+            _mm256_and_ps(_mm256_cmp_ps(d43, zero, _CMP_GE_OQ), _mm256_cmp_ps(d56, zero, _CMP_GE_OQ)));
+        t = _mm256_div_ps(d43, _mm256_add_ps(d43, d56));
+        qx = _mm256_blendv_ps(qx, _mm256_add_ps(v[3], _mm256_mul_ps(_mm256_sub_ps(v[6], v[3]), t)), mask);
+        qy = _mm256_blendv_ps(qy, _mm256_add_ps(v[4], _mm256_mul_ps(_mm256_sub_ps(v[7], v[4]), t)), mask);
+        qz = _mm256_blendv_ps(qz, _mm256_add_ps(v[5], _mm256_mul_ps(_mm256_sub_ps(v[8], v[5]), t)), mask);
+
+        mask = _mm256_and_ps(_mm256_cmp_ps(vb, zero, _CMP_LE_OQ),
+            _mm256_and_ps(_mm256_cmp_ps(d2, zero, _CMP_GE_OQ), _mm256_cmp_ps(d6, zero, _CMP_LE_OQ)));
+        t = _mm256_div_ps(d2, _mm256_sub_ps(d2, d6));
+        qx = _mm256_blendv_ps(qx, _mm256_add_ps(v[0], _mm256_mul_ps(acx, t)), mask);
+        qy = _mm256_blendv_ps(qy, _mm256_add_ps(v[1], _mm256_mul_ps(acy, t)), mask);
+        qz = _mm256_blendv_ps(qz, _mm256_add_ps(v[2], _mm256_mul_ps(acz, t)), mask);
+
+        mask = _mm256_and_ps(_mm256_cmp_ps(d6, zero, _CMP_GE_OQ), _mm256_cmp_ps(d5, d6, _CMP_LE_OQ));
+        qx = _mm256_blendv_ps(qx, v[6], mask);
+        qy = _mm256_blendv_ps(qy, v[7], mask);
+        qz = _mm256_blendv_ps(qz, v[8], mask);
+
+        mask = _mm256_and_ps(_mm256_cmp_ps(vc, zero, _CMP_LE_OQ),
+            _mm256_and_ps(_mm256_cmp_ps(d1, zero, _CMP_GE_OQ), _mm256_cmp_ps(d3, zero, _CMP_LE_OQ)));
+        t = _mm256_div_ps(d1, _mm256_sub_ps(d1, d3));
+        qx = _mm256_blendv_ps(qx, _mm256_add_ps(v[0], _mm256_mul_ps(abx, t)), mask);
+        qy = _mm256_blendv_ps(qy, _mm256_add_ps(v[1], _mm256_mul_ps(aby, t)), mask);
+        qz = _mm256_blendv_ps(qz, _mm256_add_ps(v[2], _mm256_mul_ps(abz, t)), mask);
+
+        mask = _mm256_and_ps(_mm256_cmp_ps(d3, zero, _CMP_GE_OQ), _mm256_cmp_ps(d4, d3, _CMP_LE_OQ));
+        qx = _mm256_blendv_ps(qx, v[3], mask);
+        qy = _mm256_blendv_ps(qy, v[4], mask);
+        qz = _mm256_blendv_ps(qz, v[5], mask);
+
+        mask = _mm256_and_ps(_mm256_cmp_ps(d1, zero, _CMP_LE_OQ), _mm256_cmp_ps(d2, zero, _CMP_LE_OQ));
+        qx = _mm256_blendv_ps(qx, v[0], mask);
+        qy = _mm256_blendv_ps(qy, v[1], mask);
+        qz = _mm256_blendv_ps(qz, v[2], mask);
+
+        __m256 dx = _mm256_sub_ps(px, qx);
+        __m256 dy = _mm256_sub_ps(py, qy);
+        __m256 dz = _mm256_sub_ps(pz, qz);
+        __m256 dist2 = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(dx, dx), _mm256_mul_ps(dy, dy)), _mm256_mul_ps(dz, dz));
+        int bits = _mm256_movemask_ps(_mm256_cmp_ps(dist2, r2, _CMP_LT_OQ));
+
+        int lanes = start + count - i;
+        if (lanes < 8)
+        {
+            bits &= (1 << lanes) - 1;
+        }
+        while (bits)
+        {
+            int lane = 0;
+            while (!(bits & (1 << lane))) lane++;
+            hits[numHits++] = i + lane;
+            bits &= bits - 1;
+        }
+    }
+    return numHits;
+}
+
+#endif
+
+typedef int (*SphereTrianglesFn)(const TriangleSoA &, int, int, const mat4 &, vec3, float, int *);
+
+static SimdKernel currentKernel = KERNEL_SCALAR;
+static SphereTrianglesFn currentFn = findSphereTrianglesScalar;
+static bool kernelChosen = false;
+
+bool setSphereTriangleKernel(SimdKernel kernel)
+{
+    if (!isSimdKernelSupported(kernel))
+    {
+        return false;
+    }
+
+    currentKernel = kernel;
+    kernelChosen = true;
+    switch (kernel)
+    {
+#ifdef SIMD_X86
+        case KERNEL_SSE:
+            currentFn = findSphereTrianglesSSE;
+            break;
+        case KERNEL_AVX2:
+            currentFn = findSphereTrianglesAVX2;
+            break;
+#endif
+        default:
+            currentFn = findSphereTrianglesScalar;
+            break;
+    }
+    return true;
+}
+
+SimdKernel getSphereTriangleKernel()
+{
+    if (!kernelChosen)
+    {
+        setSphereTriangleKernel(getBestSimdKernel());
+    }
+    return currentKernel;
+}
+
+int findSphereTriangles(const TriangleSoA &tris, int start, int count, const mat4 &M, vec3 center, float radius, int *hits)
+{
+    getSphereTriangleKernel();
+    return currentFn(tris, start, count, M, center, radius, hits);
+}
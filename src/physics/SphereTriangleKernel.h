@@ -0,0 +1,34 @@
+#pragma once
+
+#include <glm/glm.hpp>
+#include <vector>
+
+#include "Simd.h"
+
+using namespace glm;
+using namespace std;
+
+class Shape;
+
+// Triangles of a collision mesh in local space, stored as one array per
+// coordinate so several triangles can be tested at once with SSE or AVX2.
+// Triangles are kept in the order of the mesh's BVH so that a leaf is a
+// contiguous run, and the arrays are padded so a packet of 8 can start at any triangle.
+struct TriangleSoA
+{
+    void build(Shape &shape);
+
+    vector<float> ax, ay, az;
+    vector<float> bx, by, bz;
+    vector<float> cx, cy, cz;
+    int count;
+};
+
+// Tests the sphere against triangles [start, start + count) after transforming them by M.
+// Writes the position of every triangle closer to center than radius into hits and
+// returns how many there were. hits needs room for count entries.
+int findSphereTriangles(const TriangleSoA &tris, int start, int count, const mat4 &M, vec3 center, float radius, int *hits);
+
+// The kernel starts out as the fastest one the CPU supports
+SimdKernel getSphereTriangleKernel();
+bool setSphereTriangleKernel(SimdKernel kernel); // false if the CPU doesn't support it
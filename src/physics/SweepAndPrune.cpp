@@ -0,0 +1,134 @@
+#include "SweepAndPrune.h"
+
+void SweepAndPrune::findOverlaps(const vector<shared_ptr<PhysicsObject>> &objects, vector<BroadphasePair> &pairs)
+{
+    // the sorted lists are only valid for the same set of objects
+    if (!sameObjects(objects))
+    {
+        rebuild(objects);
+    }
+    else
+    {
+        // sleeping objects keep their endpoints, so they never swap with each
+        // other and only cost anything when a moving object passes them
+        updateBounds(objects, true);
+        for (int axis = 0; axis < 3; axis++)
+        {
+            sortAxis(axis);
+        }
+    }
+
+    // overlapping has to keep pairs of objects that aren't moving, or they'd
+    // be missed when one of them wakes up without any endpoints swapping
+    pairs.clear();
+    for (uint64_t key : overlapping)
+    {
+        BroadphasePair pair;
+        pair.a = (int)(key >> 32);
+        pair.b = (int)(key & 0xffffffff);
+        if (moving[pair.a] || moving[pair.b])
+        {
+            pairs.push_back(pair);
+        }
+    }
+    sort(pairs.begin(), pairs.end());
+}
+
+void SweepAndPrune::rebuild(const vector<shared_ptr<PhysicsObject>> &objects)
+{
+    for (int axis = 0; axis < 3; axis++)
+    {
+        endpoints[axis].resize(objects.size() * 2);
+        for (int i = 0; i < (int)objects.size(); i++)
+        {
+            endpoints[axis][i * 2].proxy = i;
+            endpoints[axis][i * 2].isMax = false;
+            endpoints[axis][i * 2 + 1].proxy = i;
+            endpoints[axis][i * 2 + 1].isMax = true;
+        }
+    }
+    updateBounds(objects, false);
+    for (int axis = 0; axis < 3; axis++)
+    {
+        sort(endpoints[axis].begin(), endpoints[axis].end(), less);
+    }
+
+    // sweep along x to find the initial set of overlapping pairs
+    overlapping.clear();
+    vector<int> active;
+    for (const Endpoint &e : endpoints[0])
+    {
+        if (e.isMax)
+        {
+            active.erase(find(active.begin(), active.end(), e.proxy));
+        }
+        else
+        {
+            for (int other : active)
+            {
+                if (overlaps(e.proxy, other))
+                {
+                    overlapping.insert(pairKey(e.proxy, other));
+                }
+            }
+            active.push_back(e.proxy);
+        }
+    }
+}
+
+void SweepAndPrune::updateBounds(const vector<shared_ptr<PhysicsObject>> &objects, bool keepAsleep)
+{
+    computeBounds(objects, keepAsleep);
+
+    for (int axis = 0; axis < 3; axis++)
+    {
+        for (Endpoint &e : endpoints[axis])
+        {
+            e.value = e.isMax ? maxs[e.proxy][axis] : mins[e.proxy][axis];
+        }
+    }
+}
+
+void SweepAndPrune::sortAxis(int axis)
+{
+    vector<Endpoint> &list = endpoints[axis];
+    for (int i = 1; i < (int)list.size(); i++)
+    {
+        Endpoint key = list[i];
+        int j = i - 1;
+        while (j >= 0 && less(key, list[j]))
+        {
+            const Endpoint &swapped = list[j];
+            if (swapped.proxy != key.proxy)
+            {
+                if (!key.isMax && swapped.isMax)
+                {
+                    // a min moved below another object's max, so they may start overlapping
+                    if (overlaps(key.proxy, swapped.proxy))
+                    {
+                        overlapping.insert(pairKey(key.proxy, swapped.proxy));
+                    }
+                }
+                else if (key.isMax && !swapped.isMax)
+                {
+                    // a max moved below another object's min, so they stopped overlapping
+                    overlapping.erase(pairKey(key.proxy, swapped.proxy));
+                }
+            }
+            list[j + 1] = list[j];
+            j--;
+        }
+        list[j + 1] = key;
+    }
+}
+
+// Mins sort before maxes at the same value so that touching bounds count as overlapping
+bool SweepAndPrune::less(const Endpoint &e0, const Endpoint &e1)
+{
+    return e0.value < e1.value || (e0.value == e1.value && !e0.isMax && e1.isMax);
+}
+
+bool SweepAndPrune::overlaps(int a, int b) const
+{
+    return Broadphase::overlaps(mins[a], maxs[a], mins[b], maxs[b]);
+}
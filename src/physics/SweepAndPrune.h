@@ -0,0 +1,34 @@
+#pragma once
+
+#include <unordered_set>
+
+#include "Broadphase.h"
+
+// http://www.codercorner.com/SAP.pdf
+// Keeps the endpoints of every object's bounds sorted along each axis between
+// frames. Objects barely move from one step to the next, so re-sorting with
+// insertion sort is close to linear, and the set of overlapping pairs only
+// has to be touched when two endpoints actually swap.
+class SweepAndPrune : public Broadphase
+{
+protected:
+    virtual void findOverlaps(const vector<shared_ptr<PhysicsObject>> &objects, vector<BroadphasePair> &pairs);
+
+private:
+    struct Endpoint
+    {
+        float value;
+        int proxy;
+        bool isMax;
+    };
+
+    static bool less(const Endpoint &e0, const Endpoint &e1);
+
+    void rebuild(const vector<shared_ptr<PhysicsObject>> &objects);
+    void updateBounds(const vector<shared_ptr<PhysicsObject>> &objects, bool keepAsleep);
+    void sortAxis(int axis);
+    bool overlaps(int a, int b) const;
+
+    vector<Endpoint> endpoints[3];
+    unordered_set<uint64_t> overlapping;
+};
@@ -0,0 +1,201 @@
+#include "TriangleBVH.h"
+
+#include <algorithm>
+#include <cmath>
+
+#define BVH_LEAF_SIZE 8
+
+TriangleBVH::TriangleBVH()
+{
+}
+
+void TriangleBVH::build(const vector<float> &posBuf, const vector<unsigned int> &eleBuf)
+{
+    int numFaces = (int)(eleBuf.size() / 3);
+    nodes.clear();
+    faces.resize(numFaces);
+    faceMins.resize(numFaces);
+    faceMaxs.resize(numFaces);
+    centroids.resize(numFaces);
+    for (int i = 0; i < numFaces; i++)
+    {
+        faces[i] = i;
+        faceMins[i] = vec3(1.1754E+38F);
+        faceMaxs[i] = vec3(-1.1754E+38F);
+        for (int j = 0; j < 3; j++)
+        {
+            unsigned int v = eleBuf[i * 3 + j];
+            vec3 p = vec3(posBuf[v * 3], posBuf[v * 3 + 1], posBuf[v * 3 + 2]);
+            faceMins[i] = min(faceMins[i], p);
+            faceMaxs[i] = max(faceMaxs[i], p);
+        }
+        centroids[i] = (faceMins[i] + faceMaxs[i]) / 2.0f;
+    }
+
+    if (numFaces > 0)
+    {
+        nodes.reserve(numFaces * 2 / BVH_LEAF_SIZE + 1);
+        buildNode(0, numFaces);
+    }
+}
+
+// Builds the subtree over faces[start, start + count) and returns its node
+int TriangleBVH::buildNode(int start, int count)
+{
+    int index = (int)nodes.size();
+    nodes.push_back(Node());
+
+    vec3 nodeMin = vec3(1.1754E+38F);
+    vec3 nodeMax = vec3(-1.1754E+38F);
+    vec3 centerMin = vec3(1.1754E+38F);
+    vec3 centerMax = vec3(-1.1754E+38F);
+    for (int i = start; i < start + count; i++)
+    {
+        nodeMin = min(nodeMin, faceMins[faces[i]]);
+        nodeMax = max(nodeMax, faceMaxs[faces[i]]);
+        centerMin = min(centerMin, centroids[faces[i]]);
+        centerMax = max(centerMax, centroids[faces[i]]);
+    }
+    nodes[index].min = nodeMin;
+    nodes[index].max = nodeMax;
+
+    if (count <= BVH_LEAF_SIZE)
+    {
+        nodes[index].start = start;
+        nodes[index].count = count;
+        return index;
+    }
+
+    // split at the median along the longest axis of the centroids
+    vec3 extent = centerMax - centerMin;
+    int axis = extent.x > extent.y ? (extent.x > extent.z ? 0 : 2) : (extent.y > extent.z ? 1 : 2);
+    int mid = start + count / 2;
+    const vector<vec3> &c = centroids;
+    nth_element(faces.begin() + start, faces.begin() + mid, faces.begin() + start + count, [&](int f0, int f1)
+    {
+        return c[f0][axis] < c[f1][axis];
+    });
+
+    buildNode(start, mid - start);
+    int second = buildNode(mid, start + count - mid);
+    nodes[index].start = second;
+    nodes[index].count = 0;
+    return index;
+}
+
+void TriangleBVH::query(const vec3 &min, const vec3 &max, vector<int> &result) const
+{
+    size_t first = result.size();
+    queryLeaves(min, max, result);
+    size_t last = result.size();
+
+    // replace the leaf ranges with the triangles in them that overlap the box
+    for (size_t r = first; r < last; r += 2)
+    {
+        int start = result[r];
+        int count = result[r + 1];
+        for (int i = start; i < start + count; i++)
+        {
+            int f = faces[i];
+            if (faceMins[f].x <= max.x && faceMaxs[f].x >= min.x &&
+                faceMins[f].y <= max.y && faceMaxs[f].y >= min.y &&
+                faceMins[f].z <= max.z && faceMaxs[f].z >= min.z)
+            {
+                result.push_back(f);
+            }
+        }
+    }
+    result.erase(result.begin() + first, result.begin() + last);
+}
+
+void TriangleBVH::queryLeaves(const vec3 &min, const vec3 &max, vector<int> &ranges) const
+{
+    if (nodes.empty()) return;
+
+    // median splits keep the tree depth near log2 of the face count
+    int stack[64];
+    int top = 0;
+    stack[top++] = 0;
+    while (top > 0)
+    {
+        int index = stack[--top];
+        const Node &node = nodes[index];
+        if (node.min.x > max.x || node.max.x < min.x ||
+            node.min.y > max.y || node.max.y < min.y ||
+            node.min.z > max.z || node.max.z < min.z)
+        {
+            continue;
+        }
+
+        if (node.count > 0)
+        {
+            ranges.push_back(node.start);
+            ranges.push_back(node.count);
+        }
+        else
+        {
+            stack[top++] = node.start;
+            stack[top++] = index + 1;
+        }
+    }
+}
+
+static float distanceToBox(const vec3 &p, const vec3 &low, const vec3 &high)
+{
+    return length(max(low - p, max(vec3(0), p - high)));
+}
+
+float TriangleBVH::queryNearest(const vec3 &p, float slack, const function<float(int)> &distanceTo) const
+{
+    float best = INFINITY;
+    if (nodes.empty()) return best;
+
+    int stack[64];
+    int top = 0;
+    stack[top++] = 0;
+    while (top > 0)
+    {
+        int index = stack[--top];
+        const Node &node = nodes[index];
+        if (distanceToBox(p, node.min, node.max) > best + slack)
+        {
+            continue;
+        }
+
+        if (node.count > 0)
+        {
+            for (int i = node.start; i < node.start + node.count; i++)
+            {
+                best = std::min(best, distanceTo(faces[i]));
+            }
+        }
+        else
+        {
+            // the nearer child goes on top, so the further one can often be skipped
+            int near = index + 1;
+            int far = node.start;
+            if (distanceToBox(p, nodes[near].min, nodes[near].max) > distanceToBox(p, nodes[far].min, nodes[far].max))
+            {
+                swap(near, far);
+            }
+            stack[top++] = far;
+            stack[top++] = near;
+        }
+    }
+    return best;
+}
+
+int TriangleBVH::getFace(int i) const
+{
+    return faces[i];
+}
+
+int TriangleBVH::getNumFaces() const
+{
+    return (int)faces.size();
+}
+
+bool TriangleBVH::empty() const
+{
+    return nodes.empty();
+}
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <glm/glm.hpp>
+#include <functional>
+#include <vector>
+
+using namespace glm;
+using namespace std;
+
+// Static bounding volume hierarchy over the triangles of a mesh, in the mesh's
+// local space. Built once for collision meshes so a sphere only has to look at
+// the triangles near it.
+class TriangleBVH
+{
+public:
+    TriangleBVH();
+
+    void build(const vector<float> &posBuf, const vector<unsigned int> &eleBuf);
+    // Appends the index of every triangle whose bounds overlap the box
+    void query(const vec3 &min, const vec3 &max, vector<int> &faces) const;
+    // Appends (start, count) for every leaf whose bounds overlap the box. The
+    // triangles of a leaf are getFace(start) to getFace(start + count - 1).
+    void queryLeaves(const vec3 &min, const vec3 &max, vector<int> &ranges) const;
+    // Calls distanceTo(face) for the triangles near p, nearest leaves first, skipping
+    // any whose bounds are more than slack further away than the nearest distance it
+    // has returned so far. Returns that distance.
+    float queryNearest(const vec3 &p, float slack, const function<float(int)> &distanceTo) const;
+    int getFace(int i) const;
+    int getNumFaces() const;
+    bool empty() const;
+
+private:
+    struct Node
+    {
+        vec3 min;
+        vec3 max;
+        int start; // first triangle for leaves, second child for inner nodes
+        int count; // 0 for inner nodes, the first child is the next node
+    };
+
+    int buildNode(int start, int count);
+
+    vector<Node> nodes;
+    vector<int> faces; // triangle indices, grouped by leaf
+    vector<vec3> faceMins;
+    vector<vec3> faceMaxs;
+    vector<vec3> centroids;
+};
@@ -0,0 +1,95 @@
+#include "WorkerPool.h"
+
+#include <algorithm>
+
+WorkerPool::WorkerPool(int threads) :
+    job(nullptr), jobCount(0), nextJob(0), busy(0), generation(0), stopping(false)
+{
+    if (threads <= 0)
+    {
+        threads = (std::max)(1, (int)thread::hardware_concurrency());
+    }
+    for (int i = 1; i < threads; i++)
+    {
+        workers.push_back(thread(&WorkerPool::workerLoop, this));
+    }
+}
+
+WorkerPool::~WorkerPool()
+{
+    {
+        lock_guard<mutex> guard(lock);
+        stopping = true;
+    }
+    wake.notify_all();
+    for (thread &t : workers)
+    {
+        t.join();
+    }
+}
+
+void WorkerPool::run(int count, const function<void(int)> &job)
+{
+    if (workers.empty() || count <= 1)
+    {
+        for (int i = 0; i < count; i++)
+        {
+            job(i);
+        }
+        return;
+    }
+
+    {
+        lock_guard<mutex> guard(lock);
+        this->job = &job;
+        jobCount = count;
+        nextJob = 0;
+        busy = (int)workers.size();
+        generation++;
+    }
+    wake.notify_all();
+
+    runJobs();
+
+    unique_lock<mutex> guard(lock);
+    done.wait(guard, [this] { return busy == 0; });
+    this->job = nullptr;
+}
+
+int WorkerPool::getNumThreads() const
+{
+    return (int)workers.size() + 1;
+}
+
+void WorkerPool::workerLoop()
+{
+    unsigned int seen = 0;
+    while (true)
+    {
+        {
+            unique_lock<mutex> guard(lock);
+            wake.wait(guard, [this, seen] { return stopping || generation != seen; });
+            if (stopping)
+            {
+                return;
+            }
+            seen = generation;
+        }
+
+        runJobs();
+
+        lock_guard<mutex> guard(lock);
+        if (--busy == 0)
+        {
+            done.notify_one();
+        }
+    }
+}
+
+void WorkerPool::runJobs()
+{
+    for (int i = nextJob++; i < jobCount; i = nextJob++)
+    {
+        (*job)(i);
+    }
+}
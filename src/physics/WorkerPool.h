@@ -0,0 +1,41 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+// A fixed set of threads for splitting physics work into independent jobs.
+// The thread calling run takes jobs too, so a pool of 1 thread runs everything
+// on the caller. One pool is meant to be shared by all the physics steps.
+class WorkerPool
+{
+public:
+    WorkerPool(int threads = 0); // 0 uses one thread per core
+    ~WorkerPool();
+
+    // Calls job(i) for every i in [0, count) and returns once all of them are done.
+    // Which thread runs which job is not fixed, so jobs must not depend on each other.
+    void run(int count, const function<void(int)> &job);
+
+    int getNumThreads() const;
+
+private:
+    void workerLoop();
+    void runJobs();
+
+    vector<thread> workers;
+    mutex lock;
+    condition_variable wake;
+    condition_variable done;
+    const function<void(int)> *job;
+    int jobCount;
+    atomic<int> nextJob;
+    int busy; // workers still working on the current run
+    unsigned int generation; // bumped for each run so workers don't run one twice
+    bool stopping;
+};